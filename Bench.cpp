@@ -0,0 +1,135 @@
+#include "Bench.h"
+
+static volatile uint16_t benchOverflows = 0;
+static const char *benchName = "";
+static uint32_t benchSamples[BENCH_SAMPLES];
+static uint16_t benchCalls = 0;
+static uint32_t benchMin = 0;
+static uint32_t benchMax = 0;
+static uint32_t benchTotal = 0;
+
+/*********************************************************
+ * void benchClockBegin()
+ *
+ * Timer 1 isn't used by anything else, so it free runs
+ * at the CPU clock and its overflow interrupt counts the
+ * top 16 bits. That is one count per cycle where micros()
+ * only resolves 4 us. The run time stats share it.
+ * *******************************************************/
+void benchClockBegin()
+{
+    static bool started = false;
+    if(started)
+    {
+        return;
+    }
+    started = true;
+#if defined(__AVR_ATmega2560__) || defined(__AVR_ATmega1280__)
+    uint8_t sreg = SREG;
+    cli();
+    TCCR1A = 0;
+    TCCR1B = _BV(CS10);
+    TCNT1 = 0;
+    TIFR1 = _BV(TOV1);
+    TIMSK1 |= _BV(TOIE1);
+    SREG = sreg;
+#endif
+}
+
+void benchBegin()
+{
+    benchClockBegin();
+    Serial.println("BENCH,name,calls,min_us,mean_us,p99_us,max_us,per_s");
+}
+
+uint32_t benchCycles()
+{
+#if defined(__AVR_ATmega2560__) || defined(__AVR_ATmega1280__)
+    uint8_t sreg = SREG;
+    cli();
+    uint16_t low = TCNT1;
+    uint16_t high = benchOverflows;
+    if((TIFR1 & _BV(TOV1)) && low < 0x8000)
+    {
+        high++; // overflowed since interrupts went off, the interrupt hasn't counted it yet
+    }
+    SREG = sreg;
+    return ((uint32_t) high << 16) | low;
+#else
+    return micros() * (F_CPU / 1000000UL);
+#endif
+}
+
+void benchReset(const char *name)
+{
+    benchName = name;
+    benchCalls = 0;
+    benchMin = 0xFFFFFFFFUL;
+    benchMax = 0;
+    benchTotal = 0;
+}
+
+void benchAdd(uint32_t cycles)
+{
+    if(benchCalls < BENCH_SAMPLES)
+    {
+        benchSamples[benchCalls] = cycles;
+    }
+    benchCalls++;
+    benchTotal += cycles;
+    if(cycles < benchMin)
+    {
+        benchMin = cycles;
+    }
+    if(cycles > benchMax)
+    {
+        benchMax = cycles;
+    }
+}
+
+static void benchPrintUs(uint32_t cycles)
+{
+    Serial.print(',');
+    Serial.print(cycles / (F_CPU / 1000000.0), 2);
+}
+
+void benchReport(uint32_t workPerCall)
+{
+    if(benchCalls == 0)
+    {
+        return;
+    }
+
+    // insertion sort, the kept samples are few and this runs once per run
+    uint16_t kept = benchCalls < BENCH_SAMPLES ? benchCalls : BENCH_SAMPLES;
+    for(uint16_t i = 1; i < kept; i++)
+    {
+        uint32_t v = benchSamples[i];
+        uint16_t j = i;
+        while(j > 0 && benchSamples[j - 1] > v)
+        {
+            benchSamples[j] = benchSamples[j - 1];
+            j--;
+        }
+        benchSamples[j] = v;
+    }
+    uint16_t p99 = ((uint32_t) kept * 99 + 99) / 100 - 1;
+
+    Serial.print("BENCH,");
+    Serial.print(benchName);
+    Serial.print(',');
+    Serial.print(benchCalls);
+    benchPrintUs(benchMin);
+    benchPrintUs(benchTotal / benchCalls);
+    benchPrintUs(benchSamples[p99]);
+    benchPrintUs(benchMax);
+    Serial.print(',');
+    Serial.println((double) benchCalls * workPerCall * F_CPU / benchTotal, 1);
+}
+
+#if defined(__AVR_ATmega2560__) || defined(__AVR_ATmega1280__)
+ISR(TIMER1_OVF_vect)
+{
+    benchOverflows++;
+}
+#endif
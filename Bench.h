@@ -0,0 +1,34 @@
+#ifndef BENCH_HARNESS
+#define BENCH_HARNESS
+
+#include <Arduino.h>
+#include <Arduino_FreeRTOS.h>
+
+#define BENCH_SAMPLES 100 // calls kept per run, enough for a p99 that isn't just the max
+
+// starts the free running cycle counter, later calls do nothing
+void benchClockBegin();
+
+// starts the cycle counter and prints the column header
+void benchBegin();
+
+// CPU cycles since benchClockBegin(), wraps after about 268 s at 16 MHz.
+// timer 1 at /1 on the Mega, micros() scaled up anywhere else
+uint32_t benchCycles();
+
+// starts a new run, name is what the result line is tagged with
+void benchReset(const char *name);
+
+// records one call that took cycles cycles
+void benchAdd(uint32_t cycles);
+
+// prints the run as one line:
+//   BENCH,name,calls,min_us,mean_us,p99_us,max_us,per_s
+// per_s is work units (steps, frames, calls) handled per second of call time
+void benchReport(uint32_t workPerCall);
+
+// times one call of expr into the current run
+#define BENCH_CALL(expr) do { uint32_t benchT0 = benchCycles(); expr; benchAdd(benchCycles() - benchT0); } while(0)
+
+
+#endif
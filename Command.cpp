@@ -0,0 +1,151 @@
+#include "Command.h"
+#include "Telemetry.h"
+#ifdef __AVR__
+  #include <avr/pgmspace.h>
+#endif
+
+static const CommandDescriptor *commandTable = NULL;
+static uint8_t commandCount = 0;
+static char commandLine[COMMAND_LINE_MAX + 1];
+static uint8_t commandLength = 0;
+static bool commandOverflow = false;
+
+void commandBegin(const CommandDescriptor *table, uint8_t count)
+{
+    commandTable = table;
+    commandCount = count;
+    commandLength = 0;
+    commandOverflow = false;
+}
+
+// parses a signed decimal, the whole token has to be the number
+static bool commandNumber(const char *token, int16_t *value)
+{
+    bool negative = *token == '-';
+    if(negative)
+    {
+        token++;
+    }
+    if(*token == '\0')
+    {
+        return false;
+    }
+    int32_t n = 0;
+    for(; *token != '\0'; token++)
+    {
+        if(*token < '0' || *token > '9')
+        {
+            return false;
+        }
+        n = n * 10 + (*token - '0');
+        if(n > 32768)
+        {
+            return false;
+        }
+    }
+    if(!negative && n > 32767)
+    {
+        return false;
+    }
+    *value = negative ? -n : n;
+    return true;
+}
+
+/*********************************************************
+ * static int8_t commandRun(char *line)
+ *
+ * Splits the line on spaces in place, so the name and
+ * arguments are just pointers into it, then looks the
+ * name up in the flash table one entry at a time.
+ * *******************************************************/
+static int8_t commandRun(char *line)
+{
+    char *tokens[COMMAND_ARGS + 2];
+    uint8_t count = 0;
+    char *p = line;
+    while(*p != '\0')
+    {
+        while(*p == ' ')
+        {
+            *p++ = '\0';
+        }
+        if(*p == '\0')
+        {
+            break;
+        }
+        if(count == COMMAND_ARGS + 2)
+        {
+            return COMMAND_BAD_ARGS;
+        }
+        tokens[count++] = p;
+        while(*p != ' ' && *p != '\0')
+        {
+            p++;
+        }
+    }
+    if(count == 0)
+    {
+        return COMMAND_OK; // blank line
+    }
+
+    int16_t argv[COMMAND_ARGS];
+    for(uint8_t i = 1; i < count; i++)
+    {
+        if(i > COMMAND_ARGS || !commandNumber(tokens[i], &argv[i - 1]))
+        {
+            return COMMAND_BAD_ARGS;
+        }
+    }
+
+    CommandDescriptor command;
+    for(uint8_t i = 0; i < commandCount; i++)
+    {
+        memcpy_P(&command, &commandTable[i], sizeof(CommandDescriptor));
+        if(strncmp(tokens[0], command.name, COMMAND_NAME_MAX) == 0)
+        {
+            if(count - 1 != command.args)
+            {
+                return COMMAND_BAD_ARGS;
+            }
+            return command.handler(argv);
+        }
+    }
+    return COMMAND_UNKNOWN;
+}
+
+void commandPoll()
+{
+    while(Serial.available() > 0)
+    {
+        int c = Serial.read();
+        if(c == '\r')
+        {
+            continue;
+        }
+        if(c != '\n')
+        {
+            if(commandLength < COMMAND_LINE_MAX)
+            {
+                commandLine[commandLength++] = c;
+            }
+            else
+            {
+                commandOverflow = true;
+            }
+            continue;
+        }
+
+        int8_t result = COMMAND_TOO_LONG;
+        if(!commandOverflow)
+        {
+            commandLine[commandLength] = '\0';
+            result = commandRun(commandLine);
+        }
+        if(commandLength > 0 || commandOverflow)
+        {
+            logAck(result);
+        }
+        commandLength = 0;
+        commandOverflow = false;
+    }
+}
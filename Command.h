@@ -0,0 +1,36 @@
+#ifndef COMMAND
+#define COMMAND
+
+#include <Arduino.h>
+
+#define COMMAND_LINE_MAX 32  // longest line accepted, longer ones are thrown away whole
+#define COMMAND_ARGS 2       // most numeric arguments a command takes
+#define COMMAND_NAME_MAX 8
+
+// results, sent back as the LOG_EVT_COMMAND value. handlers return
+// COMMAND_OK or one of the errors
+#define COMMAND_OK        0
+#define COMMAND_UNKNOWN  -1 // no command by that name
+#define COMMAND_BAD_ARGS -2 // wrong number of arguments or one isn't a number
+#define COMMAND_TOO_LONG -3 // line didn't fit in COMMAND_LINE_MAX
+#define COMMAND_BUSY     -4 // the queue it feeds is full, try again
+#define COMMAND_RANGE    -5 // an argument is out of range
+
+// one command, tables of these live in flash
+struct CommandDescriptor
+{
+  char name[COMMAND_NAME_MAX];
+  uint8_t args;                            // exact number of numeric arguments
+  int8_t (*handler)(const int16_t *argv);
+};
+
+// table is a PROGMEM array of count commands
+void commandBegin(const CommandDescriptor *table, uint8_t count);
+
+// reads whatever Serial has received and runs each complete line. never
+// blocks, so the caller polls it. every line gets a LOG_EVT_COMMAND event
+// back with its result, a host should wait for it before the next line
+void commandPoll();
+
+
+#endif
@@ -0,0 +1,121 @@
+#include "FramePacer.h"
+#include "Bench.h"
+#include <task.h>
+
+// true once now has reached tick, ticks wrap
+static bool framePacerPast(TickType_t tick, TickType_t now)
+{
+    return (TickType_t) (now - tick) < portMAX_DELAY / 2;
+}
+
+static TickType_t framePacerDue(const FramePacer *pacer, uint16_t frame)
+{
+    return pacer->start + (TickType_t) (((uint32_t) frame * 1000UL / pacer->hz) / portTICK_PERIOD_MS);
+}
+
+static void framePacerCount(uint16_t *counter)
+{
+    if(*counter < 0xFFFF)
+    {
+        (*counter)++;
+    }
+}
+
+void framePacerBegin(FramePacer *pacer, uint8_t hz)
+{
+    pacer->hz = hz < FRAME_PACER_MAX_HZ ? hz : FRAME_PACER_MAX_HZ;
+    pacer->start = xTaskGetTickCount();
+    pacer->due = pacer->start;
+    pacer->frame = 0;
+    pacer->started = false;
+}
+
+/*********************************************************
+ * void framePacerFrame(FramePacer *pacer)
+ *
+ * Jitter is how far the gap since the frame before was
+ * from the gap between their due ticks, timed with the
+ * cycle counter. The ticks themselves are 16 ms apart,
+ * so a rate that isn't a whole number of ticks shows up
+ * in the due ticks and not as jitter.
+ * *******************************************************/
+void framePacerFrame(FramePacer *pacer)
+{
+    framePacerCount(&pacer->stats.frames);
+    if(pacer->hz == 0)
+    {
+        return;
+    }
+    uint32_t now = benchCycles();
+    if(pacer->started)
+    {
+        uint32_t gap = (now - pacer->lastCycles) / (F_CPU / 1000000UL);
+        uint32_t want = (uint32_t) (pacer->due - pacer->lastDue) * portTICK_PERIOD_MS * 1000UL;
+        uint32_t jitter = gap > want ? gap - want : want - gap;
+        pacer->jitterTotal += jitter;
+        framePacerCount(&pacer->jitterSamples);
+        if(jitter > pacer->stats.jitterMax)
+        {
+            pacer->stats.jitterMax = jitter;
+        }
+    }
+    pacer->started = true;
+    pacer->lastCycles = now;
+    pacer->lastDue = pacer->due;
+    TickType_t tick = xTaskGetTickCount();
+    if(pacer->due != tick && framePacerPast(pacer->due, tick))
+    {
+        framePacerCount(&pacer->stats.overruns);
+    }
+}
+
+uint16_t framePacerNext(FramePacer *pacer)
+{
+    pacer->frame++;
+    if(pacer->hz == 0)
+    {
+        return pacer->frame;
+    }
+    // a frame already overdue when the one after it is too would only flash by
+    TickType_t now = xTaskGetTickCount();
+    while(framePacerPast(framePacerDue(pacer, pacer->frame + 1), now))
+    {
+        pacer->frame++;
+        framePacerCount(&pacer->stats.dropped);
+    }
+    pacer->due = framePacerDue(pacer, pacer->frame);
+    return pacer->frame;
+}
+
+TickType_t framePacerRemaining(const FramePacer *pacer)
+{
+    TickType_t now = xTaskGetTickCount();
+    if(pacer->hz == 0 || framePacerPast(pacer->due, now))
+    {
+        return 0;
+    }
+    return pacer->due - now;
+}
+
+void framePacerDelay(FramePacer *pacer)
+{
+    // measured from frame 0 so the increment is never 0, which vTaskDelayUntil doesn't allow
+    TickType_t increment = pacer->due - pacer->start;
+    if(pacer->hz != 0 && increment > 0)
+    {
+        TickType_t wake = pacer->start;
+        vTaskDelayUntil(&wake, increment);
+    }
+}
+
+void framePacerStats(FramePacer *pacer, FramePacerStats *stats)
+{
+    taskENTER_CRITICAL();
+    *stats = pacer->stats;
+    uint32_t mean = pacer->jitterSamples > 0 ? pacer->jitterTotal / pacer->jitterSamples : 0;
+    stats->jitterMean = mean < 0xFFFF ? mean : 0xFFFF;
+    memset(&pacer->stats, 0, sizeof(FramePacerStats));
+    pacer->jitterTotal = 0;
+    pacer->jitterSamples = 0;
+    taskEXIT_CRITICAL();
+}
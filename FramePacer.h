@@ -0,0 +1,61 @@
+#ifndef FRAME_PACER
+#define FRAME_PACER
+
+#include <Arduino.h>
+#include <Arduino_FreeRTOS.h>
+
+// Runs an animation on an absolute schedule: frame n is due n / hz seconds
+// after frame 0, rounded down to a tick, however long the frames before it
+// took. A frame that runs past the next one's tick makes that one late, an
+// overrun, and frames whose time has already gone are dropped rather than
+// shown in a burst to catch up.
+
+// the fastest rate, one frame a tick
+#define FRAME_PACER_MAX_HZ (1000 / portTICK_PERIOD_MS)
+
+struct FramePacerStats
+{
+  uint16_t frames;      // frames started
+  uint16_t overruns;    // frames that started a tick or more after they were due
+  uint16_t dropped;     // frames skipped because their time had gone
+  uint16_t jitterMean;  // microseconds, how far the gap between two frames was off the schedule's
+  uint32_t jitterMax;
+};
+
+struct FramePacer
+{
+  uint8_t hz;           // 0 runs the frames back to back
+  TickType_t start;     // tick frame 0 was due
+  TickType_t due;       // tick the current frame is due
+  uint16_t frame;       // number of the current frame
+  bool started;         // a frame has started since framePacerBegin()
+  uint32_t lastCycles;  // benchCycles() when the frame before started
+  TickType_t lastDue;   // and the tick it was due
+  uint32_t jitterTotal; // microseconds, over jitterSamples samples
+  uint16_t jitterSamples;
+  FramePacerStats stats;
+};
+
+// starts a new schedule at hz frames a second with frame 0 due now.
+// hz over FRAME_PACER_MAX_HZ runs at that. the stats carry on
+void framePacerBegin(FramePacer *pacer, uint8_t hz);
+
+// call as each frame starts, takes its jitter sample
+void framePacerFrame(FramePacer *pacer);
+
+// call once a frame is done, moves the schedule on to the next frame that
+// can still be shown on time and returns its number
+uint16_t framePacerNext(FramePacer *pacer);
+
+// ticks until the current frame is due, 0 if it already is. for a task
+// that has to wait on a queue rather than sleep
+TickType_t framePacerRemaining(const FramePacer *pacer);
+
+// sleeps until the current frame is due with vTaskDelayUntil
+void framePacerDelay(FramePacer *pacer);
+
+// copies the stats out and starts them again
+void framePacerStats(FramePacer *pacer, FramePacerStats *stats);
+
+
+#endif
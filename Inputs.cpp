@@ -0,0 +1,154 @@
+#include "Inputs.h"
+#include "Trace.h"
+#include "Latency.h"
+#include <task.h>
+
+static TaskHandle_t inputConsumer = NULL;
+static volatile uint8_t inputDipState = 0;
+static volatile uint8_t inputButtonState = 0;
+static uint16_t inputCandidate = 0;
+static uint8_t inputCount = 0;
+
+/*********************************************************
+ * static uint16_t inputReadRaw()
+ *
+ * Only DIP1, DIP2 and BUTTON1 sit on pins with pin change
+ * or external interrupts, so every input is sampled from
+ * a timer instead. On the Mega that is five port reads:
+ *   DIP1 PB0  DIP2 PB2  DIP3 PL0  DIP4 PL2  DIP5 PL4
+ *   DIP6 PL6  DIP7 PG0  DIP8 PG2  BUTTON1 PE4  BUTTON3 PA7
+ * Dips come back in the low byte, buttons in the high.
+ * *******************************************************/
+static uint16_t inputReadRaw()
+{
+#if defined(__AVR_ATmega2560__) || defined(__AVR_ATmega1280__)
+    uint8_t b = PINB;
+    uint8_t l = PINL;
+    uint8_t g = PING;
+    uint8_t dips = ((b << 7) & 0x80) | ((b << 4) & 0x40)
+                 | ((l << 5) & 0x20) | ((l << 2) & 0x10) | ((l >> 1) & 0x08) | ((l >> 4) & 0x04)
+                 | ((g << 1) & 0x02) | ((g >> 2) & 0x01);
+    uint8_t buttons = ((PINE >> 4) & 0x01) | ((PINA >> 6) & 0x02);
+#else
+    static const uint8_t dipPins[8] = { DIP1, DIP2, DIP3, DIP4, DIP5, DIP6, DIP7, DIP8 };
+    uint8_t dips = 0;
+    for(uint8_t i = 0; i < 8; i++)
+    {
+        dips = (dips << 1) | (digitalRead(dipPins[i]) == HIGH ? 1 : 0);
+    }
+    uint8_t buttons = (digitalRead(BUTTON1) == HIGH ? INPUT_BUTTON1 : 0) | (digitalRead(BUTTON3) == HIGH ? INPUT_BUTTON3 : 0);
+#endif
+    return ((uint16_t) buttons << 8) | dips;
+}
+
+void inputBegin(TaskHandle_t consumer)
+{
+    pinMode(BUTTON1, INPUT);
+    pinMode(BUTTON3, INPUT);
+    pinMode(DIP1, INPUT);
+    pinMode(DIP2, INPUT);
+    pinMode(DIP3, INPUT);
+    pinMode(DIP4, INPUT);
+    pinMode(DIP5, INPUT);
+    pinMode(DIP6, INPUT);
+    pinMode(DIP7, INPUT);
+    pinMode(DIP8, INPUT);
+
+    // start from whatever is set now so the first sample isn't an event
+    inputCandidate = inputReadRaw();
+    inputDipState = inputCandidate & 0xFF;
+    inputButtonState = inputCandidate >> 8;
+    inputConsumer = consumer;
+
+#ifdef __AVR__
+    uint8_t sreg = SREG;
+    cli();
+    TCCR5A = 0;
+    TCCR5B = _BV(WGM52) | _BV(CS51) | _BV(CS50);
+    TCNT5 = 0;
+    OCR5A = (F_CPU / 64UL) / INPUT_SAMPLE_HZ - 1;
+    TIMSK5 |= _BV(OCIE5A);
+    SREG = sreg;
+#endif
+}
+
+uint8_t inputDips()
+{
+    return inputDipState;
+}
+
+uint8_t inputButtons()
+{
+    return inputButtonState;
+}
+
+BaseType_t inputSampleIsr()
+{
+    uint16_t raw = inputReadRaw();
+    uint16_t stable = ((uint16_t) inputButtonState << 8) | inputDipState;
+    if(raw == stable)
+    {
+        inputCount = 0;
+        return pdFALSE;
+    }
+    if(raw != inputCandidate)
+    {
+        inputCandidate = raw; // still bouncing, start counting again
+        inputCount = 1;
+        return pdFALSE;
+    }
+    if(++inputCount < INPUT_DEBOUNCE_SAMPLES)
+    {
+        return pdFALSE;
+    }
+    inputCount = 0;
+
+    uint8_t dips = raw & 0xFF;
+    uint8_t buttons = raw >> 8;
+    uint8_t pressed = buttons & ~inputButtonState;
+    uint8_t released = inputButtonState & ~buttons;
+    uint32_t events = 0;
+    if(dips != inputDipState)
+    {
+        events |= INPUT_EVT_DIPS;
+    }
+    if(pressed & INPUT_BUTTON1)
+    {
+        events |= INPUT_EVT_BUTTON1_DOWN;
+    }
+    if(released & INPUT_BUTTON1)
+    {
+        events |= INPUT_EVT_BUTTON1_UP;
+    }
+    if(pressed & INPUT_BUTTON3)
+    {
+        events |= INPUT_EVT_BUTTON3_DOWN;
+    }
+    if(released & INPUT_BUTTON3)
+    {
+        events |= INPUT_EVT_BUTTON3_UP;
+    }
+    inputDipState = dips;
+    inputButtonState = buttons;
+    latencyInput();
+
+    BaseType_t woken = pdFALSE;
+    if(inputConsumer != NULL)
+    {
+        xTaskNotifyFromISR(inputConsumer, events, eSetBits, &woken);
+    }
+    return woken;
+}
+
+#ifdef __AVR__
+ISR(TIMER5_COMPA_vect)
+{
+    TRACE_ISR_BEGIN(TRACE_ISR_INPUTS);
+    BaseType_t woken = inputSampleIsr();
+    TRACE_ISR_END(TRACE_ISR_INPUTS);
+    if(woken == pdTRUE)
+    {
+        portYIELD_FROM_ISR(); // vDipSwitch handles the change now, not at the next tick
+    }
+}
+#endif
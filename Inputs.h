@@ -0,0 +1,57 @@
+#ifndef INPUTS
+#define INPUTS
+
+#include <Arduino.h>
+#include <Arduino_FreeRTOS.h>
+
+#define BUTTON1 2
+#define BUTTON2 28 // shares D28 with stepper IN2 so it isn't sampled
+#define BUTTON3 29
+
+#define DIP1 53 // DIP starts at 1 instead of 0 so it matches the dip switch board for clarity
+#define DIP2 51
+#define DIP3 49
+#define DIP4 47
+#define DIP5 45
+#define DIP6 43
+#define DIP7 41
+#define DIP8 39
+
+#define INPUT_SAMPLE_HZ 500       // timer 5 sampling rate
+#define INPUT_DEBOUNCE_SAMPLES 4  // samples a change has to hold for before it counts
+
+// notification bits sent to the consumer task
+#define INPUT_EVT_DIPS          0x01 // any dip switch changed
+#define INPUT_EVT_BUTTON1_DOWN  0x02
+#define INPUT_EVT_BUTTON1_UP    0x04
+#define INPUT_EVT_BUTTON3_DOWN  0x08
+#define INPUT_EVT_BUTTON3_UP    0x10
+#define INPUT_EVT_ALL           0x1F
+
+// bits of inputButtons()
+#define INPUT_BUTTON1 0x01
+#define INPUT_BUTTON3 0x02
+
+// sets up the pins and starts sampling from the timer 5 interrupt.
+// consumer gets a notification with INPUT_EVT_ bits set whenever something changes
+void inputBegin(TaskHandle_t consumer);
+
+// debounced dip switches packed into a byte, DIP1 is bit 7 down to DIP8 in bit 0.
+// so the top nibble is dips 1 - 4 and the bottom 3 bits are dips 6 - 8
+uint8_t inputDips();
+
+// debounced buttons, INPUT_BUTTON1 and INPUT_BUTTON3
+uint8_t inputButtons();
+
+// HIGH or LOW for dip switch n (1 - 8), reads the debounced state not the pin
+#define inputDip(n) ((inputDips() >> (8 - (n))) & 1)
+
+// HIGH or LOW for a button, b is INPUT_BUTTON1 or INPUT_BUTTON3
+#define inputButton(b) ((inputButtons() & (b)) ? HIGH : LOW)
+
+// body of the sampling interrupt. returns pdTRUE when a change woke the
+// consumer and it should run before the interrupt returns
+BaseType_t inputSampleIsr();
+
+
+#endif
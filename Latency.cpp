@@ -0,0 +1,205 @@
+#include "Latency.h"
+#include "Bench.h"
+#include <Arduino_FreeRTOS.h>
+#include <task.h>
+
+#define LATENCY_FIRST_TOP 256UL // microseconds, top of bucket 0
+#define LATENCY_TIMEOUT_CYCLES ((uint32_t) LATENCY_TIMEOUT_MS * (F_CPU / 1000UL))
+
+static LatencyHistogram latencyModes[LATENCY_MODES];
+static volatile uint8_t latencyMode = 0;
+static volatile bool latencyWaiting = false;
+static volatile uint32_t latencyStart = 0;  // cycles when the waiting input changed
+static volatile uint16_t latencyInputs = 0; // changes so far, the newest one is the one waiting. never 0 after the first
+static TaskHandle_t latencyResponder = NULL; // task between latencyAnswerBegin() and latencyAnswerEnd()
+static uint16_t latencyAnswering = 0;        // change it is answering, 0 if none was waiting
+static bool latencyIssued = false;           // a command has been issued for it
+
+void latencyBegin()
+{
+    benchClockBegin();
+    memset(latencyModes, 0, sizeof(latencyModes));
+}
+
+void latencySetMode(uint8_t mode)
+{
+    if(mode < LATENCY_MODES)
+    {
+        latencyMode = mode;
+    }
+}
+
+// interrupts are off in all of these
+static void latencyAdd(uint32_t us)
+{
+    LatencyHistogram *h = &latencyModes[latencyMode];
+    uint8_t i = 0;
+    uint32_t top = LATENCY_FIRST_TOP;
+    while(us >= top && i < LATENCY_BUCKETS - 1)
+    {
+        top <<= 1;
+        i++;
+    }
+    if(h->buckets[i] < 0xFFFF)
+    {
+        h->buckets[i]++;
+    }
+    if(us > h->max)
+    {
+        h->max = us;
+    }
+}
+
+static void latencyClose(uint16_t *counter)
+{
+    if(*counter < 0xFFFF)
+    {
+        (*counter)++;
+    }
+    latencyWaiting = false;
+}
+
+static void latencyMiss()
+{
+    latencyClose(&latencyModes[latencyMode].missed);
+}
+
+// the cycle counter wraps after about 268 s, so a wait is given up on long before then
+static void latencyExpire(uint32_t now)
+{
+    if(latencyWaiting && now - latencyStart >= LATENCY_TIMEOUT_CYCLES)
+    {
+        latencyMiss();
+    }
+}
+
+void latencyInput()
+{
+    uint8_t sreg = SREG;
+    cli();
+    uint32_t now = benchCycles();
+    latencyExpire(now);
+    if(latencyWaiting)
+    {
+        latencyMiss(); // nothing answered the change before this one
+    }
+    latencyStart = now;
+    latencyWaiting = true;
+    latencyInputs = latencyInputs + 1 == 0 ? 1 : latencyInputs + 1;
+    SREG = sreg;
+}
+
+void latencyAnswerBegin()
+{
+    uint8_t sreg = SREG;
+    cli();
+    latencyExpire(benchCycles());
+    latencyAnswering = latencyWaiting ? latencyInputs : 0;
+    latencyIssued = false;
+    latencyResponder = xTaskGetCurrentTaskHandle();
+    SREG = sreg;
+}
+
+void latencyAnswerEnd()
+{
+    uint8_t sreg = SREG;
+    cli();
+    // a mode change whose actions found every output already as they wanted it
+    if(!latencyIssued && latencyWaiting && latencyAnswering == latencyInputs)
+    {
+        latencyClose(&latencyModes[latencyMode].ignored);
+    }
+    latencyResponder = NULL;
+    latencyAnswering = 0;
+    SREG = sreg;
+}
+
+void latencyIgnore()
+{
+    uint8_t sreg = SREG;
+    cli();
+    latencyExpire(benchCycles());
+    if(latencyWaiting)
+    {
+        latencyClose(&latencyModes[latencyMode].ignored);
+    }
+    SREG = sreg;
+}
+
+uint16_t latencyCommand()
+{
+    // the responder is a pointer, two bytes on the AVR, so it is only compared with interrupts off
+    uint8_t sreg = SREG;
+    cli();
+    uint16_t input = 0;
+    if(latencyResponder != NULL && latencyResponder == xTaskGetCurrentTaskHandle())
+    {
+        input = latencyAnswering;
+        latencyIssued = true;
+    }
+    SREG = sreg;
+    return input;
+}
+
+void latencyActuated(uint16_t input)
+{
+    if(input == 0 || !latencyWaiting)
+    {
+        return; // every output change comes through here, most with nothing to measure
+    }
+    uint8_t sreg = SREG;
+    cli();
+    uint32_t now = benchCycles();
+    latencyExpire(now);
+    // a change that came in after the command was issued is still waiting for its own answer
+    if(latencyWaiting && input == latencyInputs)
+    {
+        latencyAdd((now - latencyStart) / (F_CPU / 1000000UL));
+        latencyWaiting = false;
+    }
+    SREG = sreg;
+}
+
+void latencyGet(uint8_t mode, LatencyHistogram *histogram)
+{
+    uint8_t sreg = SREG;
+    cli();
+    latencyExpire(benchCycles());
+    *histogram = latencyModes[mode < LATENCY_MODES ? mode : 0];
+    SREG = sreg;
+}
+
+uint16_t latencyCount(const LatencyHistogram *histogram)
+{
+    uint32_t count = 0;
+    for(uint8_t i = 0; i < LATENCY_BUCKETS; i++)
+    {
+        count += histogram->buckets[i];
+    }
+    return count < 0xFFFF ? count : 0xFFFF;
+}
+
+uint32_t latencyBucketTop(uint8_t i)
+{
+    return i < LATENCY_BUCKETS - 1 ? LATENCY_FIRST_TOP << i : 0;
+}
+
+uint32_t latencyPercentile(const LatencyHistogram *histogram, uint8_t percent)
+{
+    uint32_t count = 0;
+    for(uint8_t i = 0; i < LATENCY_BUCKETS; i++)
+    {
+        count += histogram->buckets[i];
+    }
+    uint32_t want = (count * percent + 99) / 100; // samples at or under the percentile
+    uint32_t seen = 0;
+    for(uint8_t i = 0; i < LATENCY_BUCKETS; i++)
+    {
+        seen += histogram->buckets[i];
+        if(seen >= want && seen > 0)
+        {
+            return latencyBucketTop(i);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,69 @@
+#ifndef LATENCY_PROBE
+#define LATENCY_PROBE
+
+#include <Arduino.h>
+
+// Time from a debounced dip or button change to the first output it causes:
+// the first coil write of a move, the first segment write of a changed
+// display or the first show() of a pixel effect that vDipSwitch commanded
+// in answer to it. Only commands issued between latencyAnswerBegin() and
+// latencyAnswerEnd() carry the change, so a gauge move or an effect that
+// restarts on its own never closes a sample. One histogram per mode, the
+// mode running when the output changed.
+
+#define LATENCY_MODES 25        // MODE_COUNT in main.cpp
+#define LATENCY_BUCKETS 14      // bucket 0 is under 256 us, each one after doubles the top, the last has no top
+#define LATENCY_TIMEOUT_MS 5000 // a change nothing answers within this counts as missed
+
+struct LatencyHistogram
+{
+  uint16_t buckets[LATENCY_BUCKETS]; // samples in each, they stop counting at 65535
+  uint16_t missed;                   // changes with no output within LATENCY_TIMEOUT_MS or before the next change
+  uint16_t ignored;                  // changes that called for no command
+  uint32_t max;                      // longest sample, microseconds
+};
+
+// starts the cycle counter the probe is timed with and empties the histograms
+void latencyBegin();
+
+// the mode the next samples count towards, vDipSwitch sets it before each entry action
+void latencySetMode(uint8_t mode);
+
+// a dip or button changed. it restarts the clock, and a change still
+// waiting for an output counts as missed
+void latencyInput();
+
+// vDipSwitch calls these around the actions that answer the newest change,
+// a mode change or an event the mode handles. if they issue no command the
+// change counts as ignored
+void latencyAnswerBegin();
+void latencyAnswerEnd();
+
+// the newest change needs no output, it counts as ignored rather than being
+// left waiting for whatever is commanded next
+void latencyIgnore();
+
+// call as an output command is issued, setDigits() of the digits already lit
+// isn't one. returns the change the calling task is answering, 0 if it isn't
+// answering one, to go along with the command
+uint16_t latencyCommand();
+
+// the output of a command changed. takes a sample if input, from latencyCommand(),
+// is still the newest change and nothing has answered it yet. safe from interrupts and tasks
+void latencyActuated(uint16_t input);
+
+// copies out the histogram of one mode
+void latencyGet(uint8_t mode, LatencyHistogram *histogram);
+
+// samples in a histogram, missed and ignored ones not included
+uint16_t latencyCount(const LatencyHistogram *histogram);
+
+// top of bucket i in microseconds, 0 for the last one
+uint32_t latencyBucketTop(uint8_t i);
+
+// top of the bucket the percent'th percentile falls in, 0 if that is the last
+// bucket or there are no samples
+uint32_t latencyPercentile(const LatencyHistogram *histogram, uint8_t percent);
+
+
+#endif
@@ -0,0 +1,258 @@
+#include "PixelEngine.h"
+#include "Latency.h"
+#include <task.h>
+#ifdef __AVR__
+  #include <avr/pgmspace.h>
+#endif
+
+// the colour tables are worked out by the compiler and live in flash.
+// gamma 2.8 is 14 / 5, so the curve only needs whole powers
+constexpr double pixelPow(double x, uint8_t n)
+{
+    return n == 0 ? 1.0 : x * pixelPow(x, n - 1);
+}
+
+// top * (level / 255) ^ 2.8 rounded, found as the highest output step in
+// lo - hi whose midpoint is still under the curve. a binary search, so the
+// recursion stays 8 deep
+constexpr uint8_t pixelCurve(uint8_t level, uint8_t top, uint8_t lo, uint8_t hi)
+{
+    return lo == hi ? lo
+        : pixelPow((((lo + hi + 1) / 2) - 0.5) / top, 5) <= pixelPow(level / 255.0, 14)
+            ? pixelCurve(level, top, (lo + hi + 1) / 2, hi)
+            : pixelCurve(level, top, lo, (lo + hi + 1) / 2 - 1);
+}
+
+constexpr uint8_t pixelLevel(uint8_t level)
+{
+    return pixelCurve(level, PIXEL_BRIGHTNESS, 0, PIXEL_BRIGHTNESS);
+}
+
+// the same scaling strip.setBrightness(PIXEL_BRIGHTNESS) did on every setPixelColor()
+constexpr uint8_t pixelScale(uint8_t level)
+{
+    return (level * (PIXEL_BRIGHTNESS + 1)) >> 8;
+}
+
+// r - g - b - back to r, the same ramps Wheel() used to work out each call
+constexpr uint32_t pixelWheelColor(uint8_t pos)
+{
+    return pos <= 85 ? PIXEL_RGBW(255 - pos * 3, pos * 3, 0, 0)
+        : pos <= 170 ? PIXEL_RGBW(0, 255 - (pos - 85) * 3, (pos - 85) * 3, 0)
+        : PIXEL_RGBW((pos - 170) * 3, 0, 255 - (pos - 170) * 3, 0);
+}
+
+#define PIXEL_LUT4(f, i)  f(i), f(i + 1), f(i + 2), f(i + 3)
+#define PIXEL_LUT16(f, i) PIXEL_LUT4(f, i), PIXEL_LUT4(f, i + 4), PIXEL_LUT4(f, i + 8), PIXEL_LUT4(f, i + 12)
+#define PIXEL_LUT64(f, i) PIXEL_LUT16(f, i), PIXEL_LUT16(f, i + 16), PIXEL_LUT16(f, i + 32), PIXEL_LUT16(f, i + 48)
+#define PIXEL_LUT256(f)   PIXEL_LUT64(f, 0), PIXEL_LUT64(f, 64), PIXEL_LUT64(f, 128), PIXEL_LUT64(f, 192)
+
+// each channel goes through one of these on its way to the strip. the pulse
+// gets gamma and brightness in one step, everything else only brightness
+constexpr uint8_t pixelLevels[256] PROGMEM = { PIXEL_LUT256(pixelLevel) };
+constexpr uint8_t pixelScaled[256] PROGMEM = { PIXEL_LUT256(pixelScale) };
+constexpr uint32_t pixelWheel[256] PROGMEM = { PIXEL_LUT256(pixelWheelColor) };
+
+static Adafruit_NeoPixel *pixelStrip = NULL;
+static uint16_t pixelCount = 0;
+static PixelEffect pixelEffect;              // running effect
+static uint16_t pixelNext = 0;               // its next frame
+static uint16_t pixelTotal = 0;              // and how many frames it has
+static volatile bool pixelRunning = false;
+static bool pixelFresh = false;              // the effect hasn't changed the strip yet
+static uint16_t pixelCause = 0;              // latencyCommand() the effect was asked for with
+static uint32_t pixelFrame[PIXEL_MAX_LEDS];  // frame being rendered
+static uint32_t pixelShown[PIXEL_MAX_LEDS];  // bytes on the strip right now, after the table
+static FramePacer pixelPacer;                // when each frame of the running effect is due
+
+// each generator fills pixelFrame with frame number frame of its effect
+static void renderSolid(const PixelEffect *fx, uint16_t frame)
+{
+    (void) frame;
+    for(uint16_t i = 0; i < pixelCount; i++)
+    {
+        pixelFrame[i] = fx->color;
+    }
+}
+
+static void renderPattern(const PixelEffect *fx, uint16_t frame)
+{
+    (void) frame;
+    for(uint16_t i = 0; i < pixelCount; i++)
+    {
+        pixelFrame[i] = fx->pattern[i];
+    }
+}
+
+static void renderWipe(const PixelEffect *fx, uint16_t frame)
+{
+    // pixels up to this frame are lit, so a dropped frame's pixel still comes on
+    for(uint8_t i = 0; i < pixelCount; i++)
+    {
+        pixelFrame[i] = i <= frame ? fx->color : 0;
+    }
+}
+
+static void renderProgress(const PixelEffect *fx, uint16_t frame)
+{
+    (void) frame;
+    uint16_t lit = (uint16_t) fx->level * pixelCount; // in 1/255ths of a pixel
+    for(uint16_t i = 0; i < pixelCount; i++)
+    {
+        uint16_t part = lit >= 255 ? 255 : lit;
+        lit -= part;
+        uint32_t c = fx->color;
+        pixelFrame[i] = PIXEL_RGBW(((c >> 16) & 0xFF) * part / 255, ((c >> 8) & 0xFF) * part / 255,
+                                   (c & 0xFF) * part / 255, (c >> 24) * part / 255);
+    }
+}
+
+static void renderRainbow(const PixelEffect *fx, uint16_t frame)
+{
+    (void) fx;
+    for(uint16_t i = 0; i < pixelCount; i++)
+    {
+        pixelFrame[i] = Wheel(((i * 256 / pixelCount) + frame) & 255);
+    }
+}
+
+static void renderPulse(const PixelEffect *fx, uint16_t frame)
+{
+    (void) fx;
+    uint8_t j = frame < 256 ? frame : 511 - frame; // up then back down, pixelLevels makes it look even
+    for(uint16_t i = 0; i < pixelCount; i++)
+    {
+        pixelFrame[i] = PIXEL_RGBW(0, 0, 0, j);
+    }
+}
+
+typedef void (*PixelGenerator)(const PixelEffect *fx, uint16_t frame);
+
+static const PixelGenerator pixelGenerators[PIXEL_EFFECT_COUNT] = {
+    renderSolid, renderPattern, renderWipe, renderProgress, renderRainbow, renderPulse
+};
+
+static uint16_t pixelFrames(const PixelEffect *fx)
+{
+    switch(fx->type)
+    {
+        case PIXEL_WIPE:
+            return pixelCount;
+        case PIXEL_RAINBOW:
+            return 256;
+        case PIXEL_PULSE:
+            return 512;
+        default:
+            return 1;
+    }
+}
+
+void pixelBegin(Adafruit_NeoPixel *strip)
+{
+    pixelStrip = strip;
+    pixelCount = strip->numPixels() < PIXEL_MAX_LEDS ? strip->numPixels() : PIXEL_MAX_LEDS;
+    memset(pixelShown, 0, sizeof(pixelShown));
+}
+
+void pixelStart(const PixelEffect *fx, uint16_t cause)
+{
+    if(fx->type >= PIXEL_EFFECT_COUNT)
+    {
+        return;
+    }
+    pixelEffect = *fx;
+    pixelNext = 0;
+    pixelTotal = pixelFrames(fx);
+    framePacerBegin(&pixelPacer, fx->rate);
+    pixelFresh = true;
+    pixelCause = cause;
+    pixelRunning = true;
+}
+
+/*********************************************************
+ * TickType_t pixelStep()
+ *
+ * Renders one frame of the running effect into pixelFrame.
+ * show() holds interrupts off for about 30 us a pixel, so
+ * a frame whose bytes after the table match pixelShown
+ * isn't sent. At this brightness most pulse frames round
+ * to the same bytes as the one before. The effect
+ * only lives in pixelEffect, pixelNext and pixelPacer
+ * between calls, so the caller can wait for the next frame
+ * however it likes and pixelStart() something else in
+ * between. Frames are numbered by the schedule, so one
+ * that ran long drops the frames whose time has gone and
+ * the effect still takes as long as it should.
+ * *******************************************************/
+TickType_t pixelStep()
+{
+    if(!pixelRunning)
+    {
+        return portMAX_DELAY;
+    }
+    framePacerFrame(&pixelPacer);
+    pixelGenerators[pixelEffect.type](&pixelEffect, pixelNext);
+    const uint8_t *table = pixelEffect.type == PIXEL_PULSE ? pixelLevels : pixelScaled;
+    bool changed = false;
+    for(uint16_t i = 0; i < pixelCount; i++)
+    {
+        uint32_t c = pixelFrame[i];
+        uint32_t wire = PIXEL_RGBW(pgm_read_byte(&table[(c >> 16) & 0xFF]), pgm_read_byte(&table[(c >> 8) & 0xFF]),
+                                   pgm_read_byte(&table[c & 0xFF]), pgm_read_byte(&table[c >> 24]));
+        if(wire != pixelShown[i])
+        {
+            pixelShown[i] = wire;
+            changed = true;
+        }
+    }
+    if(changed)
+    {
+        for(uint16_t i = 0; i < pixelCount; i++)
+        {
+            pixelStrip->setPixelColor(i, pixelShown[i]);
+        }
+        pixelStrip->show();
+        if(pixelFresh)
+        {
+            pixelFresh = false;
+            latencyActuated(pixelCause);
+        }
+    }
+    if(pixelNext + 1 >= pixelTotal)
+    {
+        pixelRunning = false;
+        return portMAX_DELAY;
+    }
+    uint16_t next = framePacerNext(&pixelPacer);
+    pixelNext = next < pixelTotal ? next : pixelTotal - 1; // dropping frames never skips the last one
+    return framePacerRemaining(&pixelPacer);
+}
+
+void pixelStop()
+{
+    pixelRunning = false;
+}
+
+bool pixelBusy()
+{
+    return pixelRunning;
+}
+
+void pixelPlay(const PixelEffect *fx)
+{
+    pixelStart(fx, 0);
+    while(pixelStep() != portMAX_DELAY)
+    {
+        framePacerDelay(&pixelPacer);
+    }
+}
+
+void pixelPacing(FramePacerStats *stats)
+{
+    framePacerStats(&pixelPacer, stats);
+}
+
+uint32_t Wheel(byte WheelPos)
+{
+    return pgm_read_dword(&pixelWheel[WheelPos]);
+}
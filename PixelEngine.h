@@ -0,0 +1,70 @@
+#ifndef PIXEL_ENGINE
+#define PIXEL_ENGINE
+
+#include <Arduino.h>
+#include <Arduino_FreeRTOS.h>
+#include <Adafruit_NeoPixel.h>
+#include "FramePacer.h"
+
+#define PIXEL_MAX_LEDS 8 // size of the frame buffers, the strip can't be longer than this
+
+// the brightest a channel gets. it is baked into the colour tables, so the
+// strip's own setBrightness() stays at full
+#define PIXEL_BRIGHTNESS 25
+
+// frame rate of the animated effects, as fast as the tick allows
+#define PIXEL_FRAME_HZ FRAME_PACER_MAX_HZ
+
+// packs a colour the same way Adafruit_NeoPixel::Color(r, g, b, w) does
+#define PIXEL_RGBW(r, g, b, w) (((uint32_t)(w) << 24) | ((uint32_t)(r) << 16) | ((uint32_t)(g) << 8) | (uint32_t)(b))
+
+// effect types, each one is a generator in pixelGenerators
+#define PIXEL_SOLID    0 // every pixel color
+#define PIXEL_PATTERN  1 // pixel i gets pattern[i]
+#define PIXEL_WIPE     2 // pixels fill with color one per frame
+#define PIXEL_PROGRESS 3 // level out of 255 of the strip lit in color, last pixel dimmed to match
+#define PIXEL_RAINBOW  4 // colour wheel spread over the strip, one turn over 256 frames
+#define PIXEL_PULSE    5 // white channel ramps up and back down through the gamma table
+#define PIXEL_EFFECT_COUNT 6
+
+struct PixelEffect
+{
+  uint8_t type;             // PIXEL_ effect type
+  uint8_t rate;             // frames a second, 0 runs them back to back
+  uint8_t level;            // PIXEL_PROGRESS fill level
+  uint32_t color;           // PIXEL_SOLID, PIXEL_WIPE and PIXEL_PROGRESS colour
+  const uint32_t *pattern;  // PIXEL_PATTERN colours, one per pixel
+};
+
+// strip is driven by pixelStep() from then on, always from the same task
+void pixelBegin(Adafruit_NeoPixel *strip);
+
+// makes fx the running effect from its first frame, replacing the one running.
+// fx is copied, pattern has to stay valid until the effect is done. cause is
+// the latencyCommand() the effect was asked for with
+void pixelStart(const PixelEffect *fx, uint16_t cause);
+
+// renders and shows the running effect's next frame. returns the ticks until
+// the one after is due on the effect's schedule, or portMAX_DELAY once the
+// effect is done. only frames that differ from what is already lit get sent
+// to the strip
+TickType_t pixelStep();
+
+// drops the running effect, the frame already shown stays lit
+void pixelStop();
+
+// true while the running effect has frames left
+bool pixelBusy();
+
+// plays an effect to the end without giving up the strip, for the benchmark
+void pixelPlay(const PixelEffect *fx);
+
+// how well the effects have kept to their frame rates since the last call
+void pixelPacing(FramePacerStats *stats);
+
+// Input a value 0 to 255 to get a color value.
+// The colours are a transition r - g - b - back to r, read from a table in flash.
+uint32_t Wheel(byte WheelPos);
+
+
+#endif
@@ -0,0 +1,53 @@
+#include "Power.h"
+#include "RunStats.h"
+#if defined(__AVR_ATmega2560__) || defined(__AVR_ATmega1280__)
+  #include <avr/sleep.h>
+  #include <avr/power.h>
+#endif
+
+/*********************************************************
+ * void powerBegin()
+ *
+ * The ADC, analog comparator, SPI, timer 2 and USARTs 1 - 3
+ * aren't used. Timer 0 (millis), timers 1, 3, 4 and 5,
+ * USART 0 and the TWI stay on. The ADC has to be disabled
+ * before its clock is stopped or it keeps drawing current.
+ * *******************************************************/
+void powerBegin()
+{
+#if defined(__AVR_ATmega2560__) || defined(__AVR_ATmega1280__)
+    ADCSRA &= ~_BV(ADEN);
+    ACSR |= _BV(ACD);
+    power_adc_disable();
+    power_spi_disable();
+    power_timer2_disable();
+    power_usart1_disable();
+    power_usart2_disable();
+    power_usart3_disable();
+#endif
+}
+
+/*********************************************************
+ * void powerIdle()
+ *
+ * Timers 1, 3, 4 and 5 and the UART all run from clkIO, so
+ * idle is the deepest sleep mode that keeps the display,
+ * stepper, inputs and serial going. Any interrupt wakes it,
+ * the watchdog tick and the TWI included. The instruction
+ * after sei() always runs before an interrupt is taken, so
+ * one that is already pending wakes the CPU straight back
+ * up instead of being counted into the sleep.
+ * *******************************************************/
+void powerIdle()
+{
+#if defined(__AVR_ATmega2560__) || defined(__AVR_ATmega1280__)
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    cli();
+    runStatsSleepBegin();
+    sleep_enable();
+    sei();
+    sleep_cpu();
+    sleep_disable();
+    runStatsSleepEnd(); // may be long after the wake if its interrupt switched tasks, the switch hook ended the sleep then
+#endif
+}
@@ -0,0 +1,14 @@
+#ifndef POWER_MANAGER
+#define POWER_MANAGER
+
+#include <Arduino.h>
+
+// gates the clocks of the peripherals nothing uses, so they draw nothing awake or asleep
+void powerBegin();
+
+// sleeps until the next interrupt, counting the time in the run stats.
+// only the idle task calls it, from loop()
+void powerIdle();
+
+
+#endif
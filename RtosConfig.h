@@ -0,0 +1,62 @@
+#ifndef RTOS_CONFIG
+#define RTOS_CONFIG
+
+// Project settings layered over the FreeRTOS library's FreeRTOSConfig.h,
+// which sets them unconditionally so -D flags can't change them.
+// platformio.ini force includes this header into every file of the build,
+// so the library config is pulled in here first and overridden, and its
+// include guard stops the later #includes from putting the old values back.
+// The kernel's trace macros are wired to the run stats and the trace
+// recorder here too, FreeRTOS.h only fills in the ones left undefined.
+
+#ifndef __ASSEMBLER__
+
+#if defined(__has_include)
+#if __has_include(<FreeRTOSConfig.h>)
+#include <FreeRTOSConfig.h>
+
+// every task stack, TCB and queue is a static buffer, so the linker map
+// accounts for all RTOS memory and nothing is left for malloc to fragment.
+// dynamic allocation stays on because the library always builds heap_3.c,
+// which #errors without it. nothing calls the dynamic create functions
+#undef configSUPPORT_STATIC_ALLOCATION
+#define configSUPPORT_STATIC_ALLOCATION 1
+
+#endif
+#endif
+
+#include "RunStats.h"
+#include "Trace.h"
+
+#ifdef TRACE
+
+#define traceTASK_SWITCHED_IN() (runStatsSwitchedIn(pxCurrentTCB), traceRecord(TRACE_SWITCH_IN, runStatsCurrent()))
+#define traceTASK_SWITCHED_OUT() (traceRecord(TRACE_SWITCH_OUT, runStatsCurrent()), runStatsSwitchedOut(pxCurrentTCB))
+#define traceTASK_INCREMENT_TICK(count) traceRecord(TRACE_TICK, 0)
+
+// semaphore gives and takes come through these too
+#define traceQUEUE_SEND(queue) traceRecordQueue(TRACE_QUEUE_SEND, queue)
+#define traceQUEUE_SEND_FROM_ISR(queue) traceRecordQueue(TRACE_QUEUE_SEND, queue)
+#define traceQUEUE_RECEIVE(queue) traceRecordQueue(TRACE_QUEUE_RECEIVE, queue)
+#define traceQUEUE_RECEIVE_FROM_ISR(queue) traceRecordQueue(TRACE_QUEUE_RECEIVE, queue)
+#define traceBLOCKING_ON_QUEUE_SEND(queue) traceRecordQueue(TRACE_QUEUE_BLOCK, queue)
+#define traceBLOCKING_ON_QUEUE_RECEIVE(queue) traceRecordQueue(TRACE_QUEUE_BLOCK, queue)
+#define traceQUEUE_SEND_FAILED(queue) traceRecordQueue(TRACE_QUEUE_FAILED, queue)
+#define traceQUEUE_RECEIVE_FAILED(queue) traceRecordQueue(TRACE_QUEUE_FAILED, queue)
+
+// pxTCB is the task being notified, in the kernel function these expand in.
+// newer kernels pass the notification index, it isn't needed
+#define traceTASK_NOTIFY(...) traceRecord(TRACE_NOTIFY, runStatsSlot(pxTCB))
+#define traceTASK_NOTIFY_FROM_ISR(...) traceRecord(TRACE_NOTIFY, runStatsSlot(pxTCB))
+
+#else
+
+#define traceTASK_SWITCHED_IN() runStatsSwitchedIn(pxCurrentTCB)
+#define traceTASK_SWITCHED_OUT() runStatsSwitchedOut(pxCurrentTCB)
+
+#endif
+
+#endif
+
+
+#endif
@@ -0,0 +1,189 @@
+#include "RunStats.h"
+#include "Bench.h"
+#include <task.h>
+
+struct RunStatsSlot
+{
+    void *task;
+    uint32_t cycles;      // running total, wraps
+    uint32_t lastCycles;  // cycles at the last sample
+    uint16_t cpu;
+    uint16_t stackFree;
+};
+
+static RunStatsSlot runStatsSlots[RUN_STATS_TASKS];
+static volatile uint8_t runStatsWatched = 0;
+static volatile int8_t runStatsRunning = -1;  // slot of the task running now, -1 for none
+static volatile uint32_t runStatsSince = 0;   // when the running task was switched in
+static volatile uint32_t runStatsIdleCycles = 0;
+static uint32_t runStatsLastIdle = 0;
+static uint32_t runStatsLastSample = 0;
+static uint16_t runStatsIdleShare = 0;
+static volatile bool runStatsSleeping = false;
+static volatile uint32_t runStatsSleepStart = 0;
+static volatile uint32_t runStatsSleepCycles = 0; // running total, wraps
+static uint32_t runStatsLastSleep = 0;
+static uint16_t runStatsSleepShare = 0;
+
+void runStatsBegin()
+{
+    benchClockBegin();
+    runStatsSince = benchCycles();
+    runStatsLastSample = runStatsSince;
+}
+
+void runStatsWatch(void *task)
+{
+    taskENTER_CRITICAL();
+    if(task != NULL && runStatsWatched < RUN_STATS_TASKS)
+    {
+        memset(&runStatsSlots[runStatsWatched], 0, sizeof(RunStatsSlot));
+        runStatsSlots[runStatsWatched].task = task;
+        runStatsWatched++;
+    }
+    taskEXIT_CRITICAL();
+}
+
+// charges the time since the last switch to whatever was running
+static void runStatsCharge(uint32_t now)
+{
+    uint32_t spent = now - runStatsSince;
+    runStatsSince = now;
+    if(runStatsRunning >= 0)
+    {
+        runStatsSlots[runStatsRunning].cycles += spent;
+    }
+    else
+    {
+        runStatsIdleCycles += spent;
+    }
+}
+
+// ends a sleep that is still being counted
+static void runStatsWake(uint32_t now)
+{
+    if(runStatsSleeping)
+    {
+        runStatsSleepCycles += now - runStatsSleepStart;
+        runStatsSleeping = false;
+    }
+}
+
+void runStatsSleepBegin()
+{
+    runStatsSleepStart = benchCycles();
+    runStatsSleeping = true;
+}
+
+void runStatsSleepEnd()
+{
+    taskENTER_CRITICAL();
+    runStatsWake(benchCycles());
+    taskEXIT_CRITICAL();
+}
+
+/*********************************************************
+ * void runStatsSwitchedIn(void *task)
+ *
+ * Runs inside the scheduler on every context switch, so
+ * it is kept to a cycle counter read and a search of a
+ * handful of slots. A task that isn't watched, the idle
+ * task included, counts as idle.
+ * *******************************************************/
+void runStatsSwitchedIn(void *task)
+{
+    runStatsCharge(benchCycles());
+    uint8_t slot = runStatsSlot(task);
+    runStatsRunning = slot == RUN_STATS_NONE ? -1 : (int8_t) slot;
+}
+
+uint8_t runStatsSlot(void *task)
+{
+    for(uint8_t i = 0; i < runStatsWatched; i++)
+    {
+        if(runStatsSlots[i].task == task)
+        {
+            return i;
+        }
+    }
+    return RUN_STATS_NONE;
+}
+
+uint8_t runStatsCurrent()
+{
+    return runStatsRunning < 0 ? RUN_STATS_NONE : (uint8_t) runStatsRunning;
+}
+
+void runStatsSwitchedOut(void *task)
+{
+    (void) task;
+    uint32_t now = benchCycles();
+    runStatsWake(now);
+    runStatsCharge(now);
+    runStatsRunning = -1;
+}
+
+// part / whole in tenths of a percent. both drop 8 bits first so part * 1000
+// fits 32 bits for sample periods up to about 4 s
+static uint16_t runStatsShare(uint32_t part, uint32_t whole)
+{
+    whole >>= 8;
+    return whole > 0 ? (uint16_t) (((part >> 8) * 1000 + whole / 2) / whole) : 0;
+}
+
+void runStatsSample()
+{
+    uint32_t cycles[RUN_STATS_TASKS];
+    taskENTER_CRITICAL();
+    uint32_t now = benchCycles();
+    runStatsCharge(now); // bring the running task up to date
+    uint8_t count = runStatsWatched;
+    for(uint8_t i = 0; i < count; i++)
+    {
+        cycles[i] = runStatsSlots[i].cycles;
+    }
+    uint32_t idle = runStatsIdleCycles;
+    uint32_t slept = runStatsSleepCycles;
+    taskEXIT_CRITICAL();
+
+    uint32_t period = now - runStatsLastSample;
+    runStatsLastSample = now;
+    for(uint8_t i = 0; i < count; i++)
+    {
+        RunStatsSlot *slot = &runStatsSlots[i];
+        slot->cpu = runStatsShare(cycles[i] - slot->lastCycles, period);
+        slot->lastCycles = cycles[i];
+        slot->stackFree = uxTaskGetStackHighWaterMark((TaskHandle_t) slot->task);
+    }
+    runStatsIdleShare = runStatsShare(idle - runStatsLastIdle, period);
+    runStatsLastIdle = idle;
+    runStatsSleepShare = runStatsShare(slept - runStatsLastSleep, period);
+    runStatsLastSleep = slept;
+}
+
+uint8_t runStatsCount()
+{
+    return runStatsWatched;
+}
+
+void runStatsGet(uint8_t i, RunStatsTask *stats)
+{
+    if(i >= runStatsWatched)
+    {
+        memset(stats, 0, sizeof(RunStatsTask));
+        return;
+    }
+    stats->name = pcTaskGetName((TaskHandle_t) runStatsSlots[i].task);
+    stats->cpu = runStatsSlots[i].cpu;
+    stats->stackFree = runStatsSlots[i].stackFree;
+}
+
+uint16_t runStatsIdle()
+{
+    return runStatsIdleShare;
+}
+
+uint16_t runStatsAsleep()
+{
+    return runStatsSleepShare;
+}
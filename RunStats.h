@@ -0,0 +1,71 @@
+#ifndef RUN_STATS
+#define RUN_STATS
+
+// Per task CPU time and stack use. RtosConfig.h hooks the switch
+// functions below into the scheduler and is force included into every
+// file of the build, so this header has to stay plain C.
+// configGENERATE_RUN_TIME_STATS could be turned on from RtosConfig.h too,
+// but uxTaskGetSystemState() wants a TaskStatus_t for every task and walks
+// every list with the scheduler suspended, and its counters can't tell
+// sleep from idle. The switch hooks give the same shares from the timer 1
+// cycle counter and split out the time asleep.
+
+#include <stdint.h>
+
+#define RUN_STATS_TASKS 8 // most tasks that can be watched
+#define RUN_STATS_NONE 0xFF // slot number of a task that isn't watched
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct
+{
+  const char *name;
+  uint16_t cpu;        // share of the last sample period, tenths of a percent
+  uint16_t stackFree;  // stack never used since the task started, in words
+} RunStatsTask;
+
+// starts the cycle counter the stats are timed with
+void runStatsBegin(void);
+
+// adds a task, task is its TaskHandle_t
+void runStatsWatch(void *task);
+
+// closes a sample period, the stats read after this cover the time since the last call
+void runStatsSample(void);
+
+// tasks being watched
+uint8_t runStatsCount(void);
+
+// copies out watched task i, as of the last runStatsSample()
+void runStatsGet(uint8_t i, RunStatsTask *stats);
+
+// share of the last sample period no watched task was running, the idle task and
+// anything unwatched, tenths of a percent
+uint16_t runStatsIdle(void);
+
+// share of the last sample period the CPU spent asleep, part of the idle share
+uint16_t runStatsAsleep(void);
+
+// the idle task calls these around sleeping, begin with interrupts off. a task
+// switch out of the idle task ends the sleep too, its wake up interrupt caused it
+void runStatsSleepBegin(void);
+void runStatsSleepEnd(void);
+
+// slot of a watched task, or RUN_STATS_NONE. task is its TaskHandle_t
+uint8_t runStatsSlot(void *task);
+
+// slot of the task running now, or RUN_STATS_NONE
+uint8_t runStatsCurrent(void);
+
+// called by the scheduler with interrupts off, task is the TCB switching in or out
+void runStatsSwitchedIn(void *task);
+void runStatsSwitchedOut(void *task);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif
@@ -0,0 +1,133 @@
+#include "SampleRing.h"
+
+#define RING_MASK (RING_SIZE - 1)
+
+void ringReset(SampleRing *ring)
+{
+    memset(ring, 0, sizeof(SampleRing));
+}
+
+/*********************************************************
+ * void ringPush(SampleRing *ring, int16_t sample)
+ *
+ * Sum and the rank weighted sum for the slope are slid
+ * along in integers, so they never drift. Once the window
+ * is full every remaining sample moves down one rank,
+ * which takes the sum of them off sumXY.
+ * Min and max are monotonic queues of ring slots: a new
+ * sample knocks out every queued one it beats, so each
+ * slot goes in and out once and the front is the answer.
+ * *******************************************************/
+void ringPush(SampleRing *ring, int16_t sample)
+{
+    uint8_t slot = ring->total & RING_MASK;
+
+    if(ring->count == RING_SIZE)
+    {
+        int16_t oldest = ring->samples[slot];
+        ring->sum -= oldest;
+        ring->sumXY -= ring->sum;
+        if(ring->minLen > 0 && ring->minQ[ring->minHead] == slot)
+        {
+            ring->minHead = (ring->minHead + 1) & RING_MASK;
+            ring->minLen--;
+        }
+        if(ring->maxLen > 0 && ring->maxQ[ring->maxHead] == slot)
+        {
+            ring->maxHead = (ring->maxHead + 1) & RING_MASK;
+            ring->maxLen--;
+        }
+    }
+    else
+    {
+        ring->count++;
+    }
+
+    ring->samples[slot] = sample;
+    ring->total++;
+    ring->sum += sample;
+    ring->sumXY += (int32_t) sample * (ring->count - 1);
+
+    if(ring->total == 1)
+    {
+        ring->ewma = (int32_t) sample << 8;
+    }
+    else
+    {
+        ring->ewma += (((int32_t) sample << 8) - ring->ewma) >> RING_EWMA_SHIFT;
+    }
+
+    while(ring->minLen > 0 && ring->samples[ring->minQ[(ring->minHead + ring->minLen - 1) & RING_MASK]] >= sample)
+    {
+        ring->minLen--;
+    }
+    ring->minQ[(ring->minHead + ring->minLen) & RING_MASK] = slot;
+    ring->minLen++;
+
+    while(ring->maxLen > 0 && ring->samples[ring->maxQ[(ring->maxHead + ring->maxLen - 1) & RING_MASK]] <= sample)
+    {
+        ring->maxLen--;
+    }
+    ring->maxQ[(ring->maxHead + ring->maxLen) & RING_MASK] = slot;
+    ring->maxLen++;
+}
+
+static int16_t ringClamp(int32_t value)
+{
+    if(value > 32767)
+    {
+        return 32767;
+    }
+    if(value < -32768)
+    {
+        return -32768;
+    }
+    return value;
+}
+
+void ringStats(const SampleRing *ring, RingStats *stats, uint16_t samplesPerMinute)
+{
+    int32_t n = ring->count;
+    stats->count = n;
+    if(n == 0)
+    {
+        memset(stats, 0, sizeof(RingStats));
+        return;
+    }
+    stats->last = ring->samples[(ring->total - 1) & RING_MASK];
+    stats->mean = (ring->sum + (ring->sum >= 0 ? n / 2 : -n / 2)) / n;
+    stats->ewma = (ring->ewma + 128) >> 8;
+    stats->min = ring->samples[ring->minQ[ring->minHead]];
+    stats->max = ring->samples[ring->maxQ[ring->maxHead]];
+
+    // least squares slope against rank, (n Sxy - Sx Sy) / (n Sxx - Sx^2). with Sx and Sxx
+    // fixed by n that is 6 c / (n (n^2 - 1)) where c = 2 Sxy - (n - 1) Sy is the sum of
+    // centred rank * sample, small enough for 32 bits. the divide is split into whole and
+    // remainder parts so scaling to per minute doesn't overflow either
+    stats->slope = 0;
+    if(n > 1)
+    {
+        int32_t q = 6 * (2 * ring->sumXY - (n - 1) * ring->sum);
+        int32_t d = n * (n * n - 1);
+        stats->slope = ringClamp(q / d * samplesPerMinute + (q % d) * samplesPerMinute / d);
+    }
+}
+
+bool ringTriggered(const RingTrigger *trigger, const RingStats *stats, int16_t reference)
+{
+    if(stats->count == 0)
+    {
+        return false;
+    }
+    switch(trigger->type)
+    {
+        case RING_TRIGGER_DELTA:
+            return abs((int32_t) stats->ewma - reference) > trigger->threshold;
+        case RING_TRIGGER_RATE:
+            return abs((int32_t) stats->slope) > trigger->threshold;
+        case RING_TRIGGER_RANGE:
+            return (int32_t) stats->max - stats->min > trigger->threshold;
+        default:
+            return false;
+    }
+}
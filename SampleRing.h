@@ -0,0 +1,63 @@
+#ifndef SAMPLE_RING
+#define SAMPLE_RING
+
+#include <Arduino.h>
+
+#define RING_SIZE 64        // samples in the window, must stay a power of two
+#define RING_EWMA_SHIFT 3   // EWMA weight of a new sample is 1 / 2^shift
+
+// window statistics, in the same units as the samples
+struct RingStats
+{
+  int16_t last;    // newest sample
+  int16_t mean;    // over the window
+  int16_t ewma;    // exponentially weighted, follows the newest samples more
+  int16_t min;     // over the window
+  int16_t max;     // over the window
+  int16_t slope;   // least squares trend over the window, units per minute
+  uint8_t count;   // samples in the window, up to RING_SIZE
+};
+
+// fixed size window of samples. every statistic is kept up to date
+// as samples arrive, so a push is O(1) amortised and nothing allocates
+struct SampleRing
+{
+  int16_t samples[RING_SIZE];
+  uint16_t total;             // samples ever pushed, the newest is at (total - 1) % RING_SIZE
+  uint8_t count;
+  int32_t sum;                // of the samples in the window
+  int32_t sumXY;              // of sample * age rank, oldest is rank 0
+  int32_t ewma;               // << 8 for the fraction
+  uint8_t minQ[RING_SIZE];    // ring slots with rising values, the front is the window min
+  uint8_t minHead;
+  uint8_t minLen;
+  uint8_t maxQ[RING_SIZE];    // ring slots with falling values, the front is the window max
+  uint8_t maxHead;
+  uint8_t maxLen;
+};
+
+// what a trigger looks at
+#define RING_TRIGGER_DELTA 0 // ewma is more than threshold away from the reference
+#define RING_TRIGGER_RATE  1 // slope is faster than threshold per minute either way
+#define RING_TRIGGER_RANGE 2 // max - min over the window is more than threshold
+
+struct RingTrigger
+{
+  uint8_t type;       // RING_TRIGGER_
+  int16_t threshold;  // in sample units
+};
+
+// empties the window
+void ringReset(SampleRing *ring);
+
+// adds a sample, dropping the oldest once the window is full
+void ringPush(SampleRing *ring, int16_t sample);
+
+// fills out the statistics, samplesPerMinute scales the slope
+void ringStats(const SampleRing *ring, RingStats *stats, uint16_t samplesPerMinute);
+
+// true if the trigger fires for stats, reference is only used by RING_TRIGGER_DELTA
+bool ringTriggered(const RingTrigger *trigger, const RingStats *stats, int16_t reference);
+
+
+#endif
@@ -0,0 +1,106 @@
+#include "Sensor.h"
+#include <Wire.h>
+
+#define SENSOR_REG_TEMPERATURE 0x00
+#define SENSOR_REG_CONFIG 0x02
+#define SENSOR_CONFIG_MODE 0x10 // high byte of the config register, temperature and humidity in sequence
+
+static SensorSnapshot sensorLatest;
+static SampleRing sensorTempRing;
+static SampleRing sensorHumRing;
+
+bool sensorBegin()
+{
+    ringReset(&sensorTempRing);
+    ringReset(&sensorHumRing);
+    memset(&sensorLatest, 0, sizeof(sensorLatest));
+
+    Wire.begin();
+    // 14 bit resolution on both channels, heater off
+    Wire.beginTransmission(SENSOR_ADDRESS);
+    Wire.write(SENSOR_REG_CONFIG);
+    Wire.write(SENSOR_CONFIG_MODE);
+    Wire.write(0x00);
+    return Wire.endTransmission() == 0;
+}
+
+/*********************************************************
+ * bool sensorTrigger()
+ *
+ * Writing the temperature register pointer starts the
+ * conversion. Unlike the ClosedCube library's reads,
+ * nothing waits here, the caller comes back for the
+ * result with sensorCollect() once the conversion time
+ * is up and can sleep in between.
+ * *******************************************************/
+bool sensorTrigger()
+{
+    Wire.beginTransmission(SENSOR_ADDRESS);
+    Wire.write(SENSOR_REG_TEMPERATURE);
+    return Wire.endTransmission() == 0;
+}
+
+/*********************************************************
+ * int16_t sensorTempCenti(uint16_t raw)
+ *
+ * The datasheet's T = raw / 2^16 * 165 - 40 scaled by
+ * 100, rounded. raw * 16500 fits 32 bits and the divide
+ * is a shift, where the float version pulled in the
+ * soft float multiply and add for every sample.
+ * *******************************************************/
+int16_t sensorTempCenti(uint16_t raw)
+{
+    return (int16_t) (((uint32_t) raw * 16500UL + 32768UL) >> 16) - 4000;
+}
+
+// RH = raw / 2^16 * 100
+int16_t sensorHumCenti(uint16_t raw)
+{
+    return (int16_t) (((uint32_t) raw * 10000UL + 32768UL) >> 16);
+}
+
+bool sensorCollect()
+{
+    // the sensor NACKs the read while it is still converting
+    if(Wire.requestFrom((uint8_t) SENSOR_ADDRESS, (uint8_t) 4) != 4)
+    {
+        return false;
+    }
+    uint16_t rawTemp = (uint16_t) Wire.read() << 8;
+    rawTemp |= Wire.read();
+    uint16_t rawHum = (uint16_t) Wire.read() << 8;
+    rawHum |= Wire.read();
+
+    int16_t temperature = sensorTempCenti(rawTemp);
+    int16_t humidity = sensorHumCenti(rawHum);
+    uint32_t stamp = millis();
+
+    // only this task touches the rings, the statistics go out with the snapshot
+    RingStats tempStats;
+    RingStats humStats;
+    ringPush(&sensorTempRing, temperature);
+    ringPush(&sensorHumRing, humidity);
+    ringStats(&sensorTempRing, &tempStats, SENSOR_SAMPLES_PER_MIN);
+    ringStats(&sensorHumRing, &humStats, SENSOR_SAMPLES_PER_MIN);
+
+    // a few dozen bytes, so readers just copy it with interrupts off instead of taking a mutex
+    taskENTER_CRITICAL();
+    sensorLatest.temperature = temperature;
+    sensorLatest.humidity = humidity;
+    sensorLatest.rawTemp = rawTemp;
+    sensorLatest.rawHum = rawHum;
+    sensorLatest.stamp = stamp;
+    sensorLatest.tempStats = tempStats;
+    sensorLatest.humStats = humStats;
+    sensorLatest.seq = sensorLatest.seq + 1 == 0 ? 1 : sensorLatest.seq + 1;
+    taskEXIT_CRITICAL();
+    return true;
+}
+
+bool sensorRead(SensorSnapshot *snap)
+{
+    taskENTER_CRITICAL();
+    *snap = sensorLatest;
+    taskEXIT_CRITICAL();
+    return snap->seq != 0;
+}
@@ -0,0 +1,46 @@
+#ifndef SENSOR
+#define SENSOR
+
+#include <Arduino.h>
+#include <Arduino_FreeRTOS.h>
+#include "SampleRing.h"
+
+#define SENSOR_ADDRESS 0x40      // HDC1080 I2C address
+#define SENSOR_PERIOD_MS 500     // how often vSensor samples
+#define SENSOR_CONVERSION_MS 15  // 14 bit temperature then 14 bit humidity take 6.35 + 6.5 ms
+#define SENSOR_SAMPLES_PER_MIN (60000UL / SENSOR_PERIOD_MS)
+
+// latest reading, published whole by the sensor task
+struct SensorSnapshot
+{
+  int16_t temperature; // hundredths of a C
+  int16_t humidity;    // hundredths of a %RH
+  uint16_t rawTemp;    // register values the readings came from, 14 bit left justified
+  uint16_t rawHum;
+  uint32_t stamp;      // millis() when the conversion was collected
+  uint16_t seq;        // counts up once per new reading, 0 means no reading yet
+  RingStats tempStats; // over the last RING_SIZE readings, hundredths of a C
+  RingStats humStats;  // over the last RING_SIZE readings, hundredths of a %RH
+};
+
+// puts the HDC1080 in combined mode, one trigger converts temperature then humidity.
+// returns false if the sensor doesn't answer
+bool sensorBegin();
+
+// starts a conversion, the result is ready SENSOR_CONVERSION_MS later
+bool sensorTrigger();
+
+// reads both channels in one 4 byte transfer and publishes them in hundredths.
+// returns false if the conversion isn't done or the read failed
+bool sensorCollect();
+
+// converts register values to hundredths of a C and of a %RH, integer maths only
+int16_t sensorTempCenti(uint16_t raw);
+int16_t sensorHumCenti(uint16_t raw);
+
+// copies out the latest snapshot, constant time and never blocks.
+// returns false if there hasn't been a reading yet
+bool sensorRead(SensorSnapshot *snap);
+
+
+#endif
@@ -1,332 +1,178 @@
 #include "SevSegNum.h"
-
-
-void printNum0on() 
-{
-    digitalWrite(SevenSegA, HIGH);    // turn the LED On by making the voltage LOW
-    digitalWrite(SevenSegB, HIGH);
-    digitalWrite(SevenSegC, HIGH);
-    digitalWrite(SevenSegD, HIGH);
-    digitalWrite(SevenSegE, HIGH);
-    digitalWrite(SevenSegF, HIGH);
-}
-
-void printNum0off()
-{
-    digitalWrite(SevenSegA, LOW);    // turn the LED off by making the voltage LOW
-    digitalWrite(SevenSegB, LOW);
-    digitalWrite(SevenSegC, LOW);
-    digitalWrite(SevenSegD, LOW);
-    digitalWrite(SevenSegE, LOW);
-    digitalWrite(SevenSegF, LOW);
-}
-
-void printNum1on()
-{
-    digitalWrite(SevenSegB, HIGH);
-    digitalWrite(SevenSegC, HIGH);
-}
-
-void printNum1off()
-{
-    digitalWrite(SevenSegB, LOW);
-    digitalWrite(SevenSegC, LOW);
-}
-
-void printNum2on()
-{
-    digitalWrite(SevenSegA, HIGH);
-    digitalWrite(SevenSegB, HIGH);
-    digitalWrite(SevenSegD, HIGH);
-    digitalWrite(SevenSegG, HIGH);
-    digitalWrite(SevenSegE, HIGH);
-}
-
-void printNum2off()
-{
-    digitalWrite(SevenSegA, LOW);
-    digitalWrite(SevenSegB, LOW);
-    digitalWrite(SevenSegD, LOW);
-    digitalWrite(SevenSegG, LOW);
-    digitalWrite(SevenSegE, LOW);
-}
-
-void printNum3on()
-{
-    digitalWrite(SevenSegA, HIGH);
-    digitalWrite(SevenSegB, HIGH);
-    digitalWrite(SevenSegC, HIGH);
-    digitalWrite(SevenSegD, HIGH);
-    digitalWrite(SevenSegG, HIGH);
-}
-
-void printNum3off()
-{
-    digitalWrite(SevenSegA, LOW);
-    digitalWrite(SevenSegB, LOW);
-    digitalWrite(SevenSegC, LOW);
-    digitalWrite(SevenSegD, LOW);
-    digitalWrite(SevenSegG, LOW);
-}
-
-void printNum4on()
-{
-    digitalWrite(SevenSegB, HIGH);
-    digitalWrite(SevenSegC, HIGH);
-    digitalWrite(SevenSegF, HIGH);
-    digitalWrite(SevenSegG, HIGH);
-}
-
-void printNum4off()
-{
-    digitalWrite(SevenSegB, LOW);
-    digitalWrite(SevenSegC, LOW);
-    digitalWrite(SevenSegF, LOW);
-    digitalWrite(SevenSegG, LOW);
-}
-
-void printNum5on()
-{
-    digitalWrite(SevenSegA, HIGH);
-    digitalWrite(SevenSegC, HIGH);
-    digitalWrite(SevenSegD, HIGH);
-    digitalWrite(SevenSegF, HIGH);
-    digitalWrite(SevenSegG, HIGH);
-}
-
-void printNum5off()
-{
-    digitalWrite(SevenSegA, LOW);
-    digitalWrite(SevenSegC, LOW);
-    digitalWrite(SevenSegD, LOW);
-    digitalWrite(SevenSegF, LOW);
-    digitalWrite(SevenSegG, LOW);
-}
-
-void printNum6on()
-{
-    digitalWrite(SevenSegA, HIGH);    // turn the LED On by making the voltage LOW
-    digitalWrite(SevenSegC, HIGH);
-    digitalWrite(SevenSegD, HIGH);
-    digitalWrite(SevenSegE, HIGH);
-    digitalWrite(SevenSegF, HIGH);
-    digitalWrite(SevenSegG, HIGH);
-}
-
-void printNum6off()
-{
-    digitalWrite(SevenSegA, LOW);    // turn the LED On by making the voltage LOW
-    digitalWrite(SevenSegC, LOW);
-    digitalWrite(SevenSegD, LOW);
-    digitalWrite(SevenSegE, LOW);
-    digitalWrite(SevenSegF, LOW);
-    digitalWrite(SevenSegG, LOW);
-}
-
-void printNum7on()
-{
-    digitalWrite(SevenSegA, HIGH);
-    digitalWrite(SevenSegB, HIGH);
-    digitalWrite(SevenSegC, HIGH);
-}
-
-void printNum7off()
-{
-    digitalWrite(SevenSegA, LOW);
-    digitalWrite(SevenSegB, LOW);
-    digitalWrite(SevenSegC, LOW);
-}
-
-void printNum8on()
-{
-    digitalWrite(SevenSegA, HIGH);    // turn the LED On by making the voltage LOW
-    digitalWrite(SevenSegB, HIGH);
-    digitalWrite(SevenSegC, HIGH);
-    digitalWrite(SevenSegD, HIGH);
-    digitalWrite(SevenSegE, HIGH);
-    digitalWrite(SevenSegF, HIGH);
-    digitalWrite(SevenSegG, HIGH);
-}
-
-void printNum8off()
-{
-    digitalWrite(SevenSegA, LOW);    // turn the LED On by making the voltage LOW
-    digitalWrite(SevenSegB, LOW);
-    digitalWrite(SevenSegC, LOW);
-    digitalWrite(SevenSegD, LOW);
-    digitalWrite(SevenSegE, LOW);
-    digitalWrite(SevenSegF, LOW);
-    digitalWrite(SevenSegG, LOW);
-}
-
-void printNum9on()
-{
-    digitalWrite(SevenSegA, HIGH);    // turn the LED On by making the voltage LOW
-    digitalWrite(SevenSegB, HIGH);
-    digitalWrite(SevenSegC, HIGH);
-    digitalWrite(SevenSegD, HIGH);
-    digitalWrite(SevenSegF, HIGH);
-    digitalWrite(SevenSegG, HIGH);
-}
-
-void printNum9off()
-{
-    digitalWrite(SevenSegA, LOW);    // turn the LED On by making the voltage LOW
-    digitalWrite(SevenSegB, LOW);
-    digitalWrite(SevenSegC, LOW);
-    digitalWrite(SevenSegD, LOW);
-    digitalWrite(SevenSegF, LOW);
-    digitalWrite(SevenSegG, LOW);
-}
-
-void printNumAon()
-{
-    digitalWrite(SevenSegA, HIGH);
-    digitalWrite(SevenSegB, HIGH);
-    digitalWrite(SevenSegC, HIGH);
-    digitalWrite(SevenSegE, HIGH);
-    digitalWrite(SevenSegF, HIGH);
-    digitalWrite(SevenSegG, HIGH);
-}
-
-void printNumAoff()
-{
-    digitalWrite(SevenSegA, LOW);
-    digitalWrite(SevenSegB, LOW);
-    digitalWrite(SevenSegC, LOW);
-    digitalWrite(SevenSegE, LOW);
-    digitalWrite(SevenSegF, LOW);
-    digitalWrite(SevenSegG, LOW);
-}
-
-void printNumBon()
-{
-    digitalWrite(SevenSegC, HIGH);
-    digitalWrite(SevenSegD, HIGH);
-    digitalWrite(SevenSegE, HIGH);
-    digitalWrite(SevenSegF, HIGH);
-    digitalWrite(SevenSegG, HIGH);
-}
-
-void printNumBoff()
-{
-    digitalWrite(SevenSegC, LOW);
-    digitalWrite(SevenSegD, LOW);
-    digitalWrite(SevenSegE, LOW);
-    digitalWrite(SevenSegF, LOW);
-    digitalWrite(SevenSegG, LOW);
-}
-
-void printNumCon()
-{
-    digitalWrite(SevenSegA, HIGH);
-    digitalWrite(SevenSegD, HIGH);
-    digitalWrite(SevenSegE, HIGH);
-    digitalWrite(SevenSegF, HIGH);
-}
-
-void printNumCoff()
-{
-    digitalWrite(SevenSegA, LOW);
-    digitalWrite(SevenSegD, LOW);
-    digitalWrite(SevenSegE, LOW);
-    digitalWrite(SevenSegF, LOW);
-}
-
-void printNumDon()
-{
-    digitalWrite(SevenSegB, HIGH);
-    digitalWrite(SevenSegC, HIGH);
-    digitalWrite(SevenSegD, HIGH);
-    digitalWrite(SevenSegE, HIGH);
-    digitalWrite(SevenSegG, HIGH);
-}
-
-void printNumDoff()
-{
-    digitalWrite(SevenSegB, LOW);
-    digitalWrite(SevenSegC, LOW);
-    digitalWrite(SevenSegD, LOW);
-    digitalWrite(SevenSegE, LOW);
-    digitalWrite(SevenSegG, LOW);
-}
-
-void printNumEon()
-{
-    digitalWrite(SevenSegA, HIGH);
-    digitalWrite(SevenSegD, HIGH);
-    digitalWrite(SevenSegE, HIGH);
-    digitalWrite(SevenSegF, HIGH);
-    digitalWrite(SevenSegG, HIGH);
-}
-
-void printNumEoff()
-{
-    digitalWrite(SevenSegA, LOW);
-    digitalWrite(SevenSegD, LOW);
-    digitalWrite(SevenSegE, LOW);
-    digitalWrite(SevenSegF, LOW);
-    digitalWrite(SevenSegG, LOW);
-}
-
-void printNumFon()
-{
-    digitalWrite(SevenSegA, HIGH);
-    digitalWrite(SevenSegE, HIGH);
-    digitalWrite(SevenSegF, HIGH);
-    digitalWrite(SevenSegG, HIGH);
-}
-
-void printNumFoff()
-{
-    digitalWrite(SevenSegA, LOW);
-    digitalWrite(SevenSegE, LOW);
-    digitalWrite(SevenSegF, LOW);
-    digitalWrite(SevenSegG, LOW);
-}
-
-void printNumLon()
-{
-    digitalWrite(SevenSegD, HIGH);
-    digitalWrite(SevenSegE, HIGH);
-    digitalWrite(SevenSegF, HIGH);
-}
-
-void printNumLoff()
-{
-    digitalWrite(SevenSegD, LOW);
-    digitalWrite(SevenSegE, LOW);
-    digitalWrite(SevenSegF, LOW);
-}
-
-void printNumRon()
-{
-    digitalWrite(SevenSegE, HIGH);
-    digitalWrite(SevenSegG, HIGH);
-}
-
-void printNumRoff()
-{
-    digitalWrite(SevenSegE, LOW);
-    digitalWrite(SevenSegG, LOW);
-}
-
-void printDPon()
-{
-    digitalWrite(SevenSegDP, HIGH);
-}
-
-void printDPoff()
-{
-    digitalWrite(SevenSegDP, LOW);
-}
-
-void printDashon()
-{
-    digitalWrite(SevenSegG, HIGH);
-}
-
-void printDashoff()
-{
-    digitalWrite(SevenSegG, LOW);
-}
\ No newline at end of file
+#include "Trace.h"
+#include "Latency.h"
+#include <task.h>
+#ifdef __AVR__
+  #include <avr/pgmspace.h>
+#endif
+
+// font table, one segment mask per glyph code. kept in flash so it costs no SRAM
+const uint8_t sevSegFont[GLYPH_COUNT] PROGMEM = {
+    SEG_A | SEG_B | SEG_C | SEG_D | SEG_E | SEG_F,          // 0
+    SEG_B | SEG_C,                                          // 1
+    SEG_A | SEG_B | SEG_D | SEG_E | SEG_G,                  // 2
+    SEG_A | SEG_B | SEG_C | SEG_D | SEG_G,                  // 3
+    SEG_B | SEG_C | SEG_F | SEG_G,                          // 4
+    SEG_A | SEG_C | SEG_D | SEG_F | SEG_G,                  // 5
+    SEG_A | SEG_C | SEG_D | SEG_E | SEG_F | SEG_G,          // 6
+    SEG_A | SEG_B | SEG_C,                                  // 7
+    SEG_A | SEG_B | SEG_C | SEG_D | SEG_E | SEG_F | SEG_G,  // 8
+    SEG_A | SEG_B | SEG_C | SEG_D | SEG_F | SEG_G,          // 9
+    SEG_A | SEG_B | SEG_C | SEG_E | SEG_F | SEG_G,          // A
+    SEG_C | SEG_D | SEG_E | SEG_F | SEG_G,                  // b
+    SEG_A | SEG_D | SEG_E | SEG_F,                          // C
+    SEG_B | SEG_C | SEG_D | SEG_E | SEG_G,                  // d
+    SEG_A | SEG_D | SEG_E | SEG_F | SEG_G,                  // E
+    SEG_A | SEG_E | SEG_F | SEG_G,                          // F
+    SEG_D | SEG_E | SEG_F,                                  // L
+    SEG_E | SEG_G,                                          // r
+    SEG_DP,                                                 // dp
+    SEG_G,                                                  // dash
+    0,                                                      // blank
+    SEG_B | SEG_C | SEG_E | SEG_F | SEG_G,                  // H
+    SEG_A | SEG_B | SEG_E | SEG_F | SEG_G,                  // P
+    SEG_B | SEG_C | SEG_D | SEG_E | SEG_F,                  // U
+    SEG_C | SEG_E | SEG_G,                                  // n
+    SEG_C | SEG_D | SEG_E | SEG_G,                          // o
+    SEG_D | SEG_E | SEG_F | SEG_G,                          // t
+    SEG_B | SEG_C | SEG_D | SEG_F | SEG_G,                  // y
+    SEG_B | SEG_C | SEG_D | SEG_E,                          // J
+    SEG_A | SEG_B | SEG_F | SEG_G,                          // degree
+    SEG_D                                                   // underscore
+};
+
+uint8_t sevSegGlyph(uint8_t glyph)
+{
+    if(glyph >= GLYPH_COUNT)
+    {
+        return 0;
+    }
+    return pgm_read_byte(&sevSegFont[glyph]);
+}
+
+/*********************************************************
+ * void sevSegWriteSegments(uint8_t segments)
+ *
+ * On the Mega pins 4 - 11 are spread over four ports:
+ *   A  -> D4  -> PG5        B  -> D5  -> PE3
+ *   C-F -> D6-D9 -> PH3-PH6 G, DP -> D10, D11 -> PB4, PB5
+ * so the mask is shifted into place and each port gets a
+ * single read-modify-write with interrupts off. Other
+ * boards fall back to digitalWrite.
+ * *******************************************************/
+void sevSegWriteSegments(uint8_t segments)
+{
+#if defined(__AVR_ATmega2560__) || defined(__AVR_ATmega1280__)
+    uint8_t g = (segments & SEG_A) << 5;
+    uint8_t e = (segments & SEG_B) << 2;
+    uint8_t h = (segments & (SEG_C | SEG_D | SEG_E | SEG_F)) << 1;
+    uint8_t b = (segments & (SEG_G | SEG_DP)) >> 2;
+    uint8_t sreg = SREG;
+    cli();
+    PORTG = (PORTG & ~_BV(5)) | g;
+    PORTE = (PORTE & ~_BV(3)) | e;
+    PORTH = (PORTH & ~(_BV(3) | _BV(4) | _BV(5) | _BV(6))) | h;
+    PORTB = (PORTB & ~(_BV(4) | _BV(5))) | b;
+    SREG = sreg;
+#else
+    for(uint8_t seg = 0; seg < 8; seg++)
+    {
+        digitalWrite(SevenSegA + seg, (segments >> seg) & 1 ? HIGH : LOW);
+    }
+#endif
+}
+
+void sevSegWriteGlyph(uint8_t glyph)
+{
+    sevSegWriteSegments(sevSegGlyph(glyph));
+}
+
+void sevSegBlank()
+{
+    sevSegWriteSegments(0);
+}
+
+// both digits' masks in one word, the left in the low byte and the right in the high.
+// masks are resolved when written so the interrupt never touches the font table
+static volatile uint16_t sevSegFrame = 0;
+static volatile uint8_t sevSegDigit = 0;
+static volatile bool sevSegChanged = false; // a new frame that differs from the old one is waiting to be lit
+static uint16_t sevSegCause = 0;            // latencyCommand() of the task that set that frame
+
+/*********************************************************
+ * void sevSegBegin(uint16_t refreshHz)
+ *
+ * Sets timer 3 to CTC mode with a /64 prescaler and fires
+ * compare A twice per refresh period, once for each digit.
+ * *******************************************************/
+void sevSegBegin(uint16_t refreshHz)
+{
+    sevSegBlank();
+    digitalWrite(SevenSegCC1, HIGH);
+    digitalWrite(SevenSegCC2, HIGH);
+#ifdef __AVR__
+    uint8_t sreg = SREG;
+    cli();
+    TCCR3A = 0;
+    TCCR3B = _BV(WGM32) | _BV(CS31) | _BV(CS30);
+    TCNT3 = 0;
+    OCR3A = (F_CPU / 64UL) / (2UL * refreshHz) - 1;
+    TIMSK3 |= _BV(OCIE3A);
+    SREG = sreg;
+#else
+    (void) refreshHz;
+#endif
+}
+
+void setDigits(uint8_t left, uint8_t right)
+{
+    uint16_t frame = sevSegGlyph(left) | ((uint16_t) sevSegGlyph(right) << 8);
+    // vDipSwitch and the digits command both call this, and a 16 bit store
+    // takes two instructions on the AVR, so it goes in with interrupts off.
+    // the interrupt then only ever sees one caller's pair of digits
+    taskENTER_CRITICAL();
+    if(frame != sevSegFrame)
+    {
+        sevSegFrame = frame;
+        sevSegChanged = true;
+        sevSegCause = latencyCommand(); // only a frame that changes is a command
+    }
+    taskEXIT_CRITICAL();
+}
+
+void sevSegRefreshIsr()
+{
+    uint8_t digit = sevSegDigit ^ 1;
+    sevSegDigit = digit;
+    sevSegBlank(); // blank first so the old glyph doesn't ghost onto the other digit
+#if defined(__AVR_ATmega2560__) || defined(__AVR_ATmega1280__)
+    // CC1 is D44 (PL5) and CC2 is D46 (PL3), driven low to light
+    if(digit == 0)
+    {
+        PORTL = (PORTL & ~_BV(3)) | _BV(5);
+    }
+    else
+    {
+        PORTL = (PORTL & ~_BV(5)) | _BV(3);
+    }
+#else
+    digitalWrite(digit == 0 ? SevenSegCC1 : SevenSegCC2, HIGH);
+    digitalWrite(digit == 0 ? SevenSegCC2 : SevenSegCC1, LOW);
+#endif
+    uint16_t frame = sevSegFrame;
+    sevSegWriteSegments(digit == 0 ? frame & 0xFF : frame >> 8);
+    if(sevSegChanged)
+    {
+        sevSegChanged = false;
+        latencyActuated(sevSegCause);
+    }
+}
+
+#ifdef __AVR__
+ISR(TIMER3_COMPA_vect)
+{
+    TRACE_ISR_BEGIN(TRACE_ISR_DISPLAY);
+    sevSegRefreshIsr();
+    TRACE_ISR_END(TRACE_ISR_DISPLAY);
+}
+#endif
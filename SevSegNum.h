@@ -4,8 +4,11 @@
 #include <Arduino.h>
 #include <Arduino_FreeRTOS.h>
 
-//#define SevenSegCC1 44
-//#define SevenSegCC2 46
+#define SevenSegCC1 44 // right digit
+#define SevenSegCC2 46 // left digit
+
+// how many times a second each digit gets lit by the refresh interrupt
+#define SEV_SEG_REFRESH_HZ 120
 
 //#define LED_BUILTIN 13
 
@@ -18,48 +21,55 @@
 #define SevenSegG 10
 #define SevenSegDP 11
 
-// this function blinks 0 to the LED
-
-void printNum0on();
-void printNum0off();
-void printNum1on();
-void printNum1off();
-void printNum2on();
-void printNum2off();
-void printNum3on();
-void printNum3off();
-void printNum4on();
-void printNum4off();
-void printNum5on();
-void printNum5off();
-void printNum6on();
-void printNum6off();
-void printNum7on();
-void printNum7off();
-void printNum8on();
-void printNum8off();
-void printNum9on();
-void printNum9off();
-void printNumAon();
-void printNumAoff();
-void printNumBon();
-void printNumBoff();
-void printNumCon();
-void printNumCoff();
-void printNumDon();
-void printNumDoff();
-void printNumEon();
-void printNumEoff();
-void printNumFon();
-void printNumFoff();
-void printNumLon();
-void printNumLoff();
-void printNumRon();
-void printNumRoff();
-void printDPon();
-void printDPoff();
-void printDashon();
-void printDashoff();
-
-
-#endif
\ No newline at end of file
+// segment bits used by the glyph font, bit 0 = A ... bit 7 = DP
+#define SEG_A  0x01
+#define SEG_B  0x02
+#define SEG_C  0x04
+#define SEG_D  0x08
+#define SEG_E  0x10
+#define SEG_F  0x20
+#define SEG_G  0x40
+#define SEG_DP 0x80
+
+// glyph codes, 0 - 15 are the hex digits so a number can be passed straight in
+#define GLYPH_L      16
+#define GLYPH_R      17
+#define GLYPH_DP     18
+#define GLYPH_DASH   19
+#define GLYPH_BLANK  20
+#define GLYPH_H      21
+#define GLYPH_P      22
+#define GLYPH_U      23
+#define GLYPH_N      24 // lower case n
+#define GLYPH_O      25 // lower case o
+#define GLYPH_T      26 // lower case t
+#define GLYPH_Y      27
+#define GLYPH_J      28
+#define GLYPH_DEGREE 29
+#define GLYPH_UNDER  30
+#define GLYPH_COUNT  31
+
+// looks up the segment mask for a glyph code, unknown codes come back blank
+uint8_t sevSegGlyph(uint8_t glyph);
+
+// writes a raw segment mask to pins 4 - 11 in one go
+void sevSegWriteSegments(uint8_t segments);
+
+// writes a glyph from the font table to pins 4 - 11
+void sevSegWriteGlyph(uint8_t glyph);
+
+// turns every segment off
+void sevSegBlank();
+
+// starts the timer 3 interrupt that multiplexes the two digits
+void sevSegBegin(uint16_t refreshHz);
+
+// sets the glyphs shown on the left and right digit, never blocks. the
+// newest call always wins, the display doesn't queue up older digits
+void setDigits(uint8_t left, uint8_t right);
+
+// body of the refresh interrupt, lights the next digit
+void sevSegRefreshIsr();
+
+
+#endif
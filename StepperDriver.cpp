@@ -0,0 +1,255 @@
+#include "StepperDriver.h"
+#include "Trace.h"
+#include "Latency.h"
+#include <math.h>
+
+#define STEPPER_TIMER_HZ (F_CPU / 64UL) // timer 4 runs at 250 kHz, 4 us per tick
+
+// full step coil pattern for IN1..IN4, same sequence the Stepper library used
+static const uint8_t stepperCoils[4] = { 0b1010, 0b0110, 0b0101, 0b1001 };
+
+// timer ticks between steps while accelerating, slowest first
+static uint16_t stepperRamp[STEPPER_RAMP_LEN];
+
+static volatile TaskHandle_t stepperOwner = NULL; // told when the running move finishes
+static volatile bool stepperRunning = false;
+static volatile uint16_t stepperLeft = 0;      // steps still to take in this move
+static volatile uint8_t stepperRampIndex = 0;  // how far up the ramp the motor is
+static uint8_t stepperRampTop = 0;             // ramp index where the move starts cruising
+static uint16_t stepperCruise = 0;             // timer ticks between steps while cruising
+static int8_t stepperDir = 1;
+static uint8_t stepperPhase = 0;
+static volatile uint16_t stepperPos = 0;       // absolute position, wraps every revolution
+static volatile bool stepperFresh = false;     // the move hasn't written the coils yet
+static uint16_t stepperCause = 0;              // latencyCommand() the move was sent with
+
+static void stepperWriteCoils(uint8_t phase)
+{
+    uint8_t coils = stepperCoils[phase];
+#if defined(__AVR_ATmega2560__) || defined(__AVR_ATmega1280__)
+    // IN1 = D24 (PA2), IN2 = D28 (PA6), IN3 = D26 (PA4), IN4 = D30 (PC7)
+    uint8_t a = ((coils & 0b1000) ? _BV(2) : 0) | ((coils & 0b0100) ? _BV(6) : 0) | ((coils & 0b0010) ? _BV(4) : 0);
+    uint8_t c = (coils & 0b0001) ? _BV(7) : 0;
+    uint8_t sreg = SREG;
+    cli();
+    PORTA = (PORTA & ~(_BV(2) | _BV(4) | _BV(6))) | a;
+    PORTC = (PORTC & ~_BV(7)) | c;
+    SREG = sreg;
+#else
+    digitalWrite(STEPPER_IN1, (coils >> 3) & 1);
+    digitalWrite(STEPPER_IN2, (coils >> 2) & 1);
+    digitalWrite(STEPPER_IN3, (coils >> 1) & 1);
+    digitalWrite(STEPPER_IN4, coils & 1);
+#endif
+}
+
+static void stepperTimerOn(uint16_t ticks)
+{
+#ifdef __AVR__
+    OCR4A = ticks;
+    TCNT4 = 0;
+    TIFR4 = _BV(OCF4A);
+    TIMSK4 |= _BV(OCIE4A);
+#else
+    (void) ticks;
+#endif
+}
+
+static void stepperTimerOff()
+{
+#ifdef __AVR__
+    TIMSK4 &= ~_BV(OCIE4A);
+#endif
+}
+
+static void stepperTimerSet(uint16_t ticks)
+{
+#ifdef __AVR__
+    OCR4A = ticks;
+#else
+    (void) ticks;
+#endif
+}
+
+/*********************************************************
+ * void stepperBegin(uint16_t accel)
+ *
+ * Builds the acceleration table once with the usual
+ * c(n) = c(n-1) - 2c(n-1) / (4n + 1) approximation of a
+ * constant acceleration ramp, so the interrupt only has
+ * to index it. Timer 4 runs in CTC mode and only has its
+ * interrupt enabled while a move is running.
+ * *******************************************************/
+void stepperBegin(uint16_t accel)
+{
+    pinMode(STEPPER_IN1, OUTPUT);
+    pinMode(STEPPER_IN2, OUTPUT);
+    pinMode(STEPPER_IN3, OUTPUT);
+    pinMode(STEPPER_IN4, OUTPUT);
+
+    float c = 0.676f * STEPPER_TIMER_HZ * sqrtf(2.0f / accel);
+    for(uint8_t n = 0; n < STEPPER_RAMP_LEN; n++)
+    {
+        if(n > 0)
+        {
+            c = c - (2.0f * c) / (4.0f * n + 1.0f);
+        }
+        stepperRamp[n] = c > 65535.0f ? 65535 : (uint16_t) c;
+    }
+
+#ifdef __AVR__
+    uint8_t sreg = SREG;
+    cli();
+    TCCR4A = 0;
+    TCCR4B = _BV(WGM42) | _BV(CS41) | _BV(CS40);
+    TIMSK4 &= ~_BV(OCIE4A);
+    SREG = sreg;
+#endif
+}
+
+void stepperStart(int8_t direction, uint16_t steps, uint16_t speed, TaskHandle_t notify, uint16_t cause)
+{
+    uint16_t cruise = speed > 0 ? STEPPER_TIMER_HZ / speed : 65535;
+    if(cruise < stepperRamp[STEPPER_RAMP_LEN - 1])
+    {
+        cruise = stepperRamp[STEPPER_RAMP_LEN - 1]; // as fast as the ramp table goes
+    }
+    uint8_t top = 0;
+    while(top < STEPPER_RAMP_LEN && stepperRamp[top] > cruise)
+    {
+        top++;
+    }
+
+    taskENTER_CRITICAL();
+    stepperTimerOff();
+    TaskHandle_t dropped = stepperRunning ? stepperOwner : NULL;
+    stepperRunning = false;
+    stepperOwner = notify;
+    if(steps > 0)
+    {
+        stepperDir = direction < 0 ? -1 : 1;
+        stepperLeft = steps;
+        stepperRampIndex = 0;
+        stepperRampTop = top;
+        stepperCruise = cruise;
+        stepperFresh = true;
+        stepperCause = cause;
+        stepperRunning = true;
+        stepperTimerOn(top > 0 ? stepperRamp[0] : cruise);
+    }
+    taskEXIT_CRITICAL();
+
+    if(dropped != NULL) // a dropped move still counts as finished
+    {
+        xTaskNotify(dropped, STEPPER_EVT_DONE, eSetBits);
+    }
+    if(steps == 0 && notify != NULL)
+    {
+        xTaskNotify(notify, STEPPER_EVT_DONE, eSetBits);
+    }
+}
+
+void stepperMoveTo(uint16_t target, uint16_t speed, TaskHandle_t notify, uint16_t cause)
+{
+    // wrap the difference into -half to +half a revolution for the short way round
+    int16_t delta = (int16_t)((target - stepperPosition()) & (STEPPER_STEPS_PER_REV - 1));
+    if(delta >= STEPPER_STEPS_PER_REV / 2)
+    {
+        delta -= STEPPER_STEPS_PER_REV;
+    }
+    if(delta < 0)
+    {
+        stepperStart(-1, -delta, speed, notify, cause);
+    }
+    else
+    {
+        stepperStart(1, delta, speed, notify, cause);
+    }
+}
+
+uint16_t stepperPosition()
+{
+    taskENTER_CRITICAL();
+    uint16_t pos = stepperPos;
+    taskEXIT_CRITICAL();
+    return pos;
+}
+
+void stepperZero()
+{
+    taskENTER_CRITICAL();
+    stepperPos = 0;
+    taskEXIT_CRITICAL();
+}
+
+void stepperStop()
+{
+    taskENTER_CRITICAL();
+    if(stepperRunning && stepperLeft > stepperRampIndex + 1)
+    {
+        stepperLeft = stepperRampIndex + 1; // just enough steps left to ramp back down
+    }
+    taskEXIT_CRITICAL();
+}
+
+bool stepperBusy()
+{
+    return stepperRunning;
+}
+
+BaseType_t stepperStepIsr()
+{
+    if(!stepperRunning)
+    {
+        return pdFALSE;
+    }
+    stepperPhase = (stepperPhase + stepperDir) & 3;
+    stepperWriteCoils(stepperPhase);
+    stepperPos = (stepperPos + stepperDir) & (STEPPER_STEPS_PER_REV - 1);
+    if(stepperFresh)
+    {
+        stepperFresh = false;
+        latencyActuated(stepperCause);
+    }
+
+    uint16_t left = stepperLeft - 1;
+    stepperLeft = left;
+    if(left == 0)
+    {
+        stepperRunning = false;
+        stepperTimerOff();
+        BaseType_t woken = pdFALSE;
+        if(stepperOwner != NULL)
+        {
+            xTaskNotifyFromISR(stepperOwner, STEPPER_EVT_DONE, eSetBits, &woken);
+        }
+        return woken;
+    }
+
+    // climb the ramp until cruising, then come back down it for the last steps
+    uint8_t k = stepperRampIndex;
+    if(left <= k)
+    {
+        k = left - 1;
+    }
+    else if(k < stepperRampTop)
+    {
+        k++;
+    }
+    stepperRampIndex = k;
+    stepperTimerSet(k < stepperRampTop ? stepperRamp[k] : stepperCruise);
+    return pdFALSE;
+}
+
+#ifdef __AVR__
+ISR(TIMER4_COMPA_vect)
+{
+    TRACE_ISR_BEGIN(TRACE_ISR_STEPPER);
+    BaseType_t woken = stepperStepIsr();
+    TRACE_ISR_END(TRACE_ISR_STEPPER);
+    if(woken == pdTRUE)
+    {
+        portYIELD_FROM_ISR(); // the task waiting on the move runs now, not at the next tick
+    }
+}
+#endif
@@ -0,0 +1,54 @@
+#ifndef STEPPER_DRIVER
+#define STEPPER_DRIVER
+
+#include <Arduino.h>
+#include <Arduino_FreeRTOS.h>
+#include <task.h>
+
+// coil pins in the order the old Stepper(2048, 24, 28, 26, 30) used them
+#define STEPPER_IN1 24
+#define STEPPER_IN2 28
+#define STEPPER_IN3 26
+#define STEPPER_IN4 30
+
+#define STEPPER_STEPS_PER_REV 2048  // must stay a power of two, positions wrap with a mask
+#define STEPPER_ACCEL 3000      // steps per second per second
+#define STEPPER_RAMP_LEN 96     // entries in the acceleration table, caps the top speed
+
+// notification bit set on the task that started a move once it finishes,
+// clear of the INPUT_EVT_ bits so vDipSwitch can wait for both
+#define STEPPER_EVT_DONE 0x80
+
+// sets up the coil pins, builds the acceleration table and hooks up timer 4
+void stepperBegin(uint16_t accel);
+
+// starts a move of steps steps at up to speed steps per second. notify gets
+// STEPPER_EVT_DONE when it finishes, NULL tells nobody. a move that is
+// already running is dropped and counts as finished for its own task.
+// cause is the latencyCommand() the move was sent with
+void stepperStart(int8_t direction, uint16_t steps, uint16_t speed, TaskHandle_t notify, uint16_t cause);
+
+// moves to an absolute position in steps, going whichever way round is shorter
+void stepperMoveTo(uint16_t target, uint16_t speed, TaskHandle_t notify, uint16_t cause);
+
+// where the shaft is, 0 to STEPPER_STEPS_PER_REV - 1 steps from where it was at power up
+uint16_t stepperPosition();
+
+// makes the current shaft position the new 0
+void stepperZero();
+
+// ramps the running move down to a stop, does nothing if idle
+void stepperStop();
+
+// true while a move is running
+bool stepperBusy();
+
+// body of the step interrupt, advances the coils one step. returns pdTRUE
+// when finishing a move woke a task that should run before the interrupt returns
+BaseType_t stepperStepIsr();
+
+// converts rpm to steps per second
+#define STEPPER_RPM_TO_SPS(rpm) ((uint16_t)(((uint32_t)(rpm) * STEPPER_STEPS_PER_REV) / 60))
+
+
+#endif
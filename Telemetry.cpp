@@ -0,0 +1,116 @@
+#include "Telemetry.h"
+#include <queue.h>
+
+static QueueHandle_t telemetryLogQueue = NULL;
+static StaticQueue_t telemetryLogQueueBuffer;
+static uint8_t telemetryLogStorage[TELEMETRY_LOG_QUEUE * sizeof(TelemetryLog)];
+static volatile uint8_t telemetryLevel = LOG_INFO;
+
+void telemetryBegin()
+{
+    telemetryLogQueue = xQueueCreateStatic(TELEMETRY_LOG_QUEUE, sizeof(TelemetryLog), telemetryLogStorage, &telemetryLogQueueBuffer);
+    traceNameQueue(telemetryLogQueue, "log");
+}
+
+void logEvent(uint8_t level, uint8_t event, int16_t value)
+{
+    if(level > telemetryLevel || telemetryLogQueue == NULL)
+    {
+        return;
+    }
+    TelemetryLog log = { TELEMETRY_LOG, level, event, value, (uint32_t) millis() };
+    xQueueSend(telemetryLogQueue, &log, 0);
+}
+
+void logAck(int8_t result)
+{
+    TelemetryLog log = { TELEMETRY_LOG, LOG_ERROR, LOG_EVT_COMMAND, result, (uint32_t) millis() };
+    xQueueSend(telemetryLogQueue, &log, portMAX_DELAY);
+}
+
+void logSetLevel(uint8_t level)
+{
+    telemetryLevel = level > LOG_DEBUG ? LOG_DEBUG : level;
+    logEvent(LOG_ERROR, LOG_EVT_LEVEL, telemetryLevel);
+}
+
+uint8_t logGetLevel()
+{
+    return telemetryLevel;
+}
+
+void telemetryDrainLog(TickType_t wait)
+{
+    TelemetryLog log;
+    while(xQueueReceive(telemetryLogQueue, &log, wait) == pdPASS)
+    {
+        telemetrySend((const uint8_t *) &log, sizeof(log));
+        wait = 0;
+    }
+}
+
+uint16_t telemetryCrc(const uint8_t *data, uint8_t length)
+{
+    uint16_t crc = 0xFFFF;
+    for(uint8_t i = 0; i < length; i++)
+    {
+        crc ^= (uint16_t) data[i] << 8;
+        for(uint8_t bit = 0; bit < 8; bit++)
+        {
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+// byte i of a frame, the payload with its CRC on the end low byte first
+static uint8_t telemetryFrameByte(const uint8_t *payload, uint8_t length, uint16_t crc, uint8_t i)
+{
+    if(i < length)
+    {
+        return payload[i];
+    }
+    return i == length ? crc & 0xFF : crc >> 8;
+}
+
+/*********************************************************
+ * void telemetrySend(const uint8_t *payload, uint8_t length)
+ *
+ * Consistent overhead byte stuffing: every 0 in the data
+ * is replaced by the distance to the next one, so the
+ * only 0 on the wire is the frame delimiter and a
+ * receiver that joins mid stream resyncs at the next one.
+ * The blocks are written straight to Serial as each 0 is
+ * found, so the frame is never copied onto the sending
+ * task's stack. Frames are shorter than 254 bytes, so no
+ * block needs the 0xFF code that has no 0 after it.
+ * *******************************************************/
+void telemetrySend(const uint8_t *payload, uint8_t length)
+{
+    if(length > TELEMETRY_MAX_FRAME)
+    {
+        return;
+    }
+    uint16_t crc = telemetryCrc(payload, length);
+    uint8_t total = length + 2;
+    uint8_t start = 0;
+    for(;;)
+    {
+        uint8_t end = start;
+        while(end < total && telemetryFrameByte(payload, length, crc, end) != 0)
+        {
+            end++;
+        }
+        Serial.write((uint8_t) (end - start + 1));
+        for(uint8_t i = start; i < end; i++)
+        {
+            Serial.write(telemetryFrameByte(payload, length, crc, i));
+        }
+        if(end == total)
+        {
+            break;
+        }
+        start = end + 1; // the 0 at end is what the code stands for
+    }
+    Serial.write((uint8_t) 0);
+}
@@ -0,0 +1,149 @@
+#ifndef TELEMETRY
+#define TELEMETRY
+
+#include <Arduino.h>
+#include <Arduino_FreeRTOS.h>
+#include "Trace.h"
+#include "Latency.h"
+
+#define TELEMETRY_BAUD 115200
+#define TELEMETRY_PERIOD_MS 1000  // how often the status frame goes out
+#define TELEMETRY_LOG_QUEUE 8     // log events waiting for the telemetry task, more get dropped
+#define TELEMETRY_MAX_FRAME 64    // largest payload, before the CRC and COBS
+
+// frame types, the first byte of every payload
+#define TELEMETRY_STATUS 0x01
+#define TELEMETRY_LOG    0x02
+#define TELEMETRY_TASK   0x03 // one per watched task, see RunStats.h
+#define TELEMETRY_TRACE_NAME 0x04 // trace builds, names a task or queue number in the events
+#define TELEMETRY_TRACE      0x05 // trace builds, a run of events from the ring, see Trace.h
+#define TELEMETRY_LATENCY    0x06 // one per mode with samples, see Latency.h
+#define TELEMETRY_FRAMES     0x07 // pixel effect frame pacing, follows the task frames
+
+#define TELEMETRY_TRACE_EVENTS 12 // events in a TELEMETRY_TRACE frame
+
+// what a TELEMETRY_TRACE_NAME frame names
+#define TELEMETRY_TRACE_TASK  0 // id is the run stats slot
+#define TELEMETRY_TRACE_QUEUE 1 // id is the number traceNameQueue() gave it
+
+// log levels, an event goes out if its level is at or below the current one
+#define LOG_ERROR 0
+#define LOG_INFO  1
+#define LOG_DEBUG 2
+
+// log events, the host decoder turns these back into text
+#define LOG_EVT_TEMP        1 // gauge moved, value is the temperature in hundredths of a C
+#define LOG_EVT_HUM         2 // value is the humidity in hundredths of a %RH
+#define LOG_EVT_STOP        3 // a stop mode was entered
+#define LOG_EVT_STEPPER     4 // move started, value is the steps or target position
+#define LOG_EVT_PIXELS      5 // value is the pixel command
+#define LOG_EVT_QUEUE_ERROR 6 // value is which queue, 0 = stepper, 1 = pixel
+#define LOG_EVT_LEVEL       7 // log level changed, value is the new level
+#define LOG_EVT_COMMAND     8 // serial command finished, value is COMMAND_OK or an error
+#define LOG_EVT_SENSOR      9 // the HDC1080 didn't answer, value is 0 for the trigger or 1 for the read
+
+// everything is little endian and packed, tools/telemetry_decode.py has the same layouts
+struct __attribute__((packed)) TelemetryStatus
+{
+  uint8_t type;         // TELEMETRY_STATUS
+  uint8_t mode;         // modeIndex()
+  uint8_t dips;         // inputDips()
+  uint8_t logLevel;
+  uint32_t stamp;       // millis()
+  uint16_t sensorSeq;
+  int16_t temperature;  // hundredths of a C
+  int16_t humidity;     // hundredths of a %RH
+  int16_t tempEwma;
+  int16_t humEwma;
+  int16_t tempSlope;    // hundredths per minute
+  int16_t humSlope;
+  uint16_t stepperPos;
+  uint8_t stepperBusy;
+};
+
+struct __attribute__((packed)) TelemetryTask
+{
+  uint8_t type;       // TELEMETRY_TASK
+  uint8_t index;      // which task, 0 to count - 1
+  uint8_t count;      // tasks being watched
+  char name[8];       // pcTaskGetName(), 0 padded
+  uint16_t cpu;       // tenths of a percent of the last period
+  uint16_t stackFree; // words never used
+  uint16_t idle;      // tenths of a percent no watched task ran, the same in every frame of a set
+  uint16_t asleep;    // tenths of a percent the CPU slept, part of idle
+};
+
+struct __attribute__((packed)) TelemetryTraceName
+{
+  uint8_t type;  // TELEMETRY_TRACE_NAME
+  uint8_t kind;  // TELEMETRY_TRACE_TASK or TELEMETRY_TRACE_QUEUE
+  uint8_t id;
+  char name[8];  // 0 padded
+};
+
+// only the first count events are sent, the dump is over once first + count reaches total
+struct __attribute__((packed)) TelemetryTrace
+{
+  uint8_t type;    // TELEMETRY_TRACE
+  uint8_t count;   // events in this frame
+  uint16_t first;  // index of the first one in the dump, 0 is the oldest
+  uint16_t total;  // events in the dump
+  TraceEvent events[TELEMETRY_TRACE_EVENTS];
+};
+
+struct __attribute__((packed)) TelemetryLatency
+{
+  uint8_t type;     // TELEMETRY_LATENCY
+  uint8_t mode;     // modeIndex() the samples were taken in
+  uint16_t missed;  // inputs with no output within LATENCY_TIMEOUT_MS or before the next one
+  uint16_t ignored; // inputs the mode had no output for
+  uint32_t max;     // microseconds
+  uint16_t buckets[LATENCY_BUCKETS]; // bucket 0 is under 256 us, each one after doubles the top
+};
+
+// FramePacerStats for the pixel effects, since the frame before
+struct __attribute__((packed)) TelemetryFrames
+{
+  uint8_t type;         // TELEMETRY_FRAMES
+  uint16_t frames;
+  uint16_t overruns;    // frames that started a tick or more late
+  uint16_t dropped;     // frames skipped to get back on schedule
+  uint16_t jitterMean;  // microseconds
+  uint32_t jitterMax;
+};
+
+struct __attribute__((packed)) TelemetryLog
+{
+  uint8_t type;    // TELEMETRY_LOG
+  uint8_t level;
+  uint8_t event;   // LOG_EVT_
+  int16_t value;
+  uint32_t stamp;  // millis()
+};
+
+// creates the log queue, call before any task logs
+void telemetryBegin();
+
+// queues a log event for the telemetry task. never blocks, an event above
+// the current level costs a compare and one that doesn't fit is dropped
+void logEvent(uint8_t level, uint8_t event, int16_t value);
+
+// queues the LOG_EVT_COMMAND ack for a serial command at every level. a host
+// waits for it before sending more, so instead of being dropped it waits for
+// room in the queue. only for a task that can block, vCommand
+void logAck(int8_t result);
+
+void logSetLevel(uint8_t level);
+uint8_t logGetLevel();
+
+// sends queued log events, waiting up to wait ticks for the first one
+void telemetryDrainLog(TickType_t wait);
+
+// appends a CRC-16, COBS encodes it and writes it out ending in a 0 byte
+void telemetrySend(const uint8_t *payload, uint8_t length);
+
+// CRC-16/CCITT-FALSE
+uint16_t telemetryCrc(const uint8_t *data, uint8_t length);
+
+
+#endif
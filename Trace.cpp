@@ -0,0 +1,101 @@
+#include "Trace.h"
+
+#ifdef TRACE
+
+#include <Arduino.h>
+#include "Bench.h"
+
+static TraceEvent traceRing[TRACE_EVENTS];
+static uint8_t traceHead = 0;           // where the next event goes
+static volatile uint16_t traceFilled = 0;
+static volatile bool traceFrozen = false;
+static void *traceQueues[TRACE_QUEUES];
+static const char *traceQueueNames[TRACE_QUEUES];
+static uint8_t traceQueuesNamed = 0;
+
+/*********************************************************
+ * void traceRecord(uint8_t type, uint8_t id)
+ *
+ * Called from inside the scheduler and from interrupts,
+ * so it is a cycle counter read and a 4 byte store. The
+ * stamp is the timer 1 count in microseconds, cut to 16
+ * bits to keep the ring small.
+ * *******************************************************/
+void traceRecord(uint8_t type, uint8_t id)
+{
+    uint8_t sreg = SREG;
+    cli();
+    if(!traceFrozen)
+    {
+        TraceEvent *event = &traceRing[traceHead++];
+        event->stamp = (uint16_t) (benchCycles() / (F_CPU / 1000000UL));
+        event->type = type;
+        event->id = id;
+        if(traceFilled < TRACE_EVENTS)
+        {
+            traceFilled++;
+        }
+    }
+    SREG = sreg;
+}
+
+void traceRecordQueue(uint8_t type, void *queue)
+{
+    uint8_t id = TRACE_NONE;
+    for(uint8_t i = 0; i < traceQueuesNamed; i++)
+    {
+        if(traceQueues[i] == queue)
+        {
+            id = i;
+            break;
+        }
+    }
+    traceRecord(type, id);
+}
+
+void traceNameQueue(void *queue, const char *name)
+{
+    if(traceQueuesNamed < TRACE_QUEUES)
+    {
+        traceQueues[traceQueuesNamed] = queue;
+        traceQueueNames[traceQueuesNamed] = name;
+        traceQueuesNamed++;
+    }
+}
+
+uint8_t traceQueueCount()
+{
+    return traceQueuesNamed;
+}
+
+const char *traceQueueName(uint8_t id)
+{
+    return id < traceQueuesNamed ? traceQueueNames[id] : "";
+}
+
+void traceFreeze()
+{
+    traceFrozen = true;
+}
+
+uint16_t traceCount()
+{
+    return traceFilled;
+}
+
+void traceGet(uint16_t i, TraceEvent *event)
+{
+    // the oldest event is traceFilled back from the head
+    *event = traceRing[(uint8_t) (traceHead - traceFilled + i)];
+}
+
+void traceRestart()
+{
+    uint8_t sreg = SREG;
+    cli();
+    traceFilled = 0;
+    traceFrozen = false;
+    SREG = sreg;
+}
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef TRACE_RECORDER
+#define TRACE_RECORDER
+
+// Timestamped scheduler, queue and interrupt events in a RAM ring, dumped
+// with the trace command and turned into a Chrome trace on the host by
+// tools/telemetry_decode.py --trace. Only built in with -DTRACE (the _trace
+// environments), otherwise the hooks are empty and the ring takes no RAM.
+// Force included everywhere through RtosConfig.h, so it has to stay plain C.
+
+#include <stdint.h>
+
+#define TRACE_EVENTS 256 // ring size, 4 bytes an event. must stay 256, the index wraps as a uint8_t
+
+// event types, the host script has the same numbers
+#define TRACE_SWITCH_IN     1 // id is the run stats slot of the task, TRACE_NONE if it isn't watched
+#define TRACE_SWITCH_OUT    2
+#define TRACE_QUEUE_SEND    3 // id is the queue's number from traceNameQueue(), semaphores are queues too
+#define TRACE_QUEUE_RECEIVE 4
+#define TRACE_QUEUE_BLOCK   5 // the running task is about to block sending to or receiving from the queue
+#define TRACE_QUEUE_FAILED  6 // a send to a full queue or a receive from an empty one gave up
+#define TRACE_NOTIFY        7 // id is the run stats slot of the task notified
+#define TRACE_ISR_ENTER     8 // id is a TRACE_ISR_ number
+#define TRACE_ISR_EXIT      9
+#define TRACE_TICK          10 // every tick, so the host can unwrap the 16 bit stamps
+
+#define TRACE_NONE 0xFF
+
+// interrupts that are traced
+#define TRACE_ISR_DISPLAY 0 // timer 3, digit multiplexing
+#define TRACE_ISR_STEPPER 1 // timer 4, one step
+#define TRACE_ISR_INPUTS  2 // timer 5, dip and button sampling
+
+#define TRACE_QUEUES 4 // most queues that can be named
+
+typedef struct __attribute__((packed))
+{
+  uint16_t stamp; // microseconds, wraps every 65 ms
+  uint8_t type;   // TRACE_ event type
+  uint8_t id;
+} TraceEvent;
+
+#ifdef TRACE
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// adds an event to the ring, overwriting the oldest. safe from interrupts
+void traceRecord(uint8_t type, uint8_t id);
+
+// the same for a queue event, queue is its QueueHandle_t
+void traceRecordQueue(uint8_t type, void *queue);
+
+// gives a queue the next number, name is what the host shows for it
+void traceNameQueue(void *queue, const char *name);
+
+uint8_t traceQueueCount(void);
+const char *traceQueueName(uint8_t id);
+
+// stops recording so the ring can be read out
+void traceFreeze(void);
+
+// events in the ring, and event i of them, 0 is the oldest
+uint16_t traceCount(void);
+void traceGet(uint16_t i, TraceEvent *event);
+
+// empties the ring and starts recording again
+void traceRestart(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define TRACE_ISR_BEGIN(isr) traceRecord(TRACE_ISR_ENTER, isr)
+#define TRACE_ISR_END(isr) traceRecord(TRACE_ISR_EXIT, isr)
+
+#else
+
+#define traceNameQueue(queue, name)
+#define TRACE_ISR_BEGIN(isr)
+#define TRACE_ISR_END(isr)
+
+#endif
+
+
+#endif
@@ -1,23 +1,25 @@
 #include <Arduino.h>
 #include <Arduino_FreeRTOS.h>
-#include <ClosedCube_HDC1080.h>
-#include <semphr.h>
 #include <queue.h>
 #include <Wire.h>
 #include <Adafruit_NeoPixel.h>
-#include <Stepper.h>
 #include "SevSegNum.h"
+#include "StepperDriver.h"
+#include "Inputs.h"
+#include "PixelEngine.h"
+#include "Bench.h"
+#include "Sensor.h"
+#include "Telemetry.h"
+#include "Command.h"
+#include "RunStats.h"
+#include "Power.h"
+#include "Latency.h"
 #ifdef __AVR__
   #include <avr/power.h>
 #endif
 
 #define PIN 24
 #define NUM_LEDS 4
-#define BRIGHTNESS 25
-
-#define BUTTON1 2
-#define BUTTON2 28
-#define BUTTON3 29
 
 #define SevenSegCC1 44
 #define SevenSegCC2 46
@@ -31,79 +33,227 @@
 #define SevenSegG 10
 #define SevenSegDP 11
 
-#define DIP1 53 // DIP starts at 1 instead of 0 so it matches the dip switch board for clarity
-#define DIP2 51
-#define DIP3 49
-#define DIP4 47
-#define DIP5 45
-#define DIP6 43
-#define DIP7 41
-#define DIP8 39
-//#define FRAME_RATE 1
+#define INPUT_IDLE_MS 100 // how long vDipSwitch sleeps when no input changes
+
+#define STEPPER_RPM 20      // cruise speed, the acceleration ramp keeps the 28BYJ from stalling
+
+// gauge scales, both keep full scale inside half a turn so the short way round never passes 0
+#define TEMP_STEPS_PER_DEG 16 // 0 - 63 C
+#define HUM_STEPS_PER_PCT 10  // 0 - 100 %RH
+#define GAUGE_TRIGGERS 2      // triggers per gauge, the gauge moves when any of them fires
+
+// task stacks in bytes, StackType_t is a byte on the AVR port
+#define DIP_STACK 512
+#define STEPPER_STACK 256   // only hands commands to the driver, the stepping is in the timer 4 interrupt
+#define PIXEL_STACK 256
+#define SENSOR_STACK 256
+#define TELEMETRY_STACK 256
+#define COMMAND_STACK 256
+#define BENCH_STACK 512
 
-#define FRAME_RATE 2/3
+#define PIXEL_CMD_STOP -1 // pixelManager() value that stops the running effect
 
 Adafruit_NeoPixel strip = Adafruit_NeoPixel(NUM_LEDS, PIN, NEO_GRBW + NEO_KHZ800);
 Adafruit_NeoPixel single = Adafruit_NeoPixel(1, PIN, NEO_GRBW + NEO_KHZ800);
 
-byte neopix_gamma[] = {
-    0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-    0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  1,  1,  1,  1,
-    1,  1,  1,  1,  1,  1,  1,  1,  1,  2,  2,  2,  2,  2,  2,  2,
-    2,  3,  3,  3,  3,  3,  3,  3,  4,  4,  4,  4,  4,  5,  5,  5,
-    5,  6,  6,  6,  6,  7,  7,  7,  7,  8,  8,  8,  9,  9,  9, 10,
-   10, 10, 11, 11, 11, 12, 12, 13, 13, 13, 14, 14, 15, 15, 16, 16,
-   17, 17, 18, 18, 19, 19, 20, 20, 21, 21, 22, 22, 23, 24, 24, 25,
-   25, 26, 27, 27, 28, 29, 29, 30, 31, 32, 32, 33, 34, 35, 35, 36,
-   37, 38, 39, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 50,
-   51, 52, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63, 64, 66, 67, 68,
-   69, 70, 72, 73, 74, 75, 77, 78, 79, 81, 82, 83, 85, 86, 87, 89,
-   90, 92, 93, 95, 96, 98, 99,101,102,104,105,107,109,110,112,114,
-  115,117,119,120,122,124,126,127,129,131,133,135,137,138,140,142,
-  144,146,148,150,152,154,156,158,160,162,164,167,169,171,173,175,
-  177,180,182,184,186,189,191,193,196,198,200,203,205,208,210,213,
-  215,218,220,223,225,228,231,233,236,239,241,244,247,249,252,255 };
+
+// one whole move for the stepper task
+struct MotionCommand
+{
+  int8_t direction;   // 1 = CW, -1 = CCW
+  uint16_t steps;     // how many steps to take, or the position to go to if absolute
+  bool absolute;      // steps is a position, the stepper goes the short way round to it
+  uint16_t speed;     // cruise speed in rpm
+  bool abort;         // stops the move that is running, the other fields are ignored
+  TaskHandle_t notify; // gets STEPPER_EVT_DONE when the move finishes, NULL if nobody waits
+  uint16_t cause;     // latencyCommand() when it was sent
+};
+
+// one pixel command for the pixel task
+struct PixelCommand
+{
+  int command;        // as pixelCommand()
+  uint16_t cause;     // latencyCommand() when it was sent
+};
+
+// what vDipSwitch does in one mode, kept in flash in modeTable
+struct ModeDescriptor
+{
+  void (*entry)();                    // runs once when the mode is switched to
+  void (*periodic)(uint32_t events);  // runs every pass, events are the INPUT_EVT_ bits that woke it
+  void (*exit)();                     // runs once when the mode is switched away from
+  uint8_t answers;                    // INPUT_EVT_ bits the periodic action has an output for
+};
+
+#define MODE_PIXEL 16        // first of the 8 pixel modes picked by dips 6 - 8
+#define MODE_PIXEL_BLANK 24  // button 1 held while in the pixel modes
+#define MODE_COUNT 25
+#define MODE_NONE 0xFF
+
+#if LATENCY_MODES < MODE_COUNT
+#error "Latency.h needs a histogram for every mode"
+#endif
 
 // task prototypes
-void vSevSegDisplay(void *pvParameters);
 void vDipSwitch(void *pvParameters);
 void vMoveStepper(void *pvParameters);
 void vPixelCommands(void *pvParameters);
+void vBenchmark(void *pvParameters);
+void vSensor(void *pvParameters);
+void vTelemetry(void *pvParameters);
+void vCommand(void *pvParameters);
 
 
 // function prototypes
-void sevSegNumbers(int);
-void printSevSeg(int, int, int);
-void segManager(int, int);
-void checkQueueIsFull(int);
-void displayPixelCommand(int, int);
 void displayPixel(int, int);
-int pixelCommand(int);
+int pixelCommand(int, uint16_t);
 int pixelManager(int);
-int rainbowCycle(uint8_t);
-int pulseWhite(uint8_t);
-void colorWipe();
-uint32_t Wheel(byte);
 uint8_t red(uint32_t);
 uint8_t green(uint32_t);
 uint8_t blue(uint32_t);
+uint8_t modeIndex();
+void modeTempEntry();
+void modeTempPeriodic(uint32_t);
+void modeHumEntry();
+void modeHumPeriodic(uint32_t);
+void modeStopEntry();
+void modeCcwEntry();
+void modeCcwPeriodic(uint32_t);
+void modeCwEntry();
+void modeCwPeriodic(uint32_t);
+void modeBackForthPeriodic(uint32_t);
+void modePixelRedEntry();
+void modePixelRedPeriodic(uint32_t);
+void modePixelGreenEntry();
+void modePixelBlueEntry();
+void modePixelWhiteEntry();
+void modePixelColorsEntry();
+void modePixelBrightEntry();
+void modePixelBlankEntry();
+void modePixelPulseEntry();
+void modePixelRainbowEntry();
+void modePixelPulsePeriodic(uint32_t);
+void modePixelRainbowPeriodic(uint32_t);
+void modePixelEffectExit();
+bool stepperSend(MotionCommand, int);
+bool stepperMove(int8_t, uint16_t, int);
+bool stepperMoveToPosition(uint16_t, int);
+uint16_t gaugePosition(int16_t, int);
+bool gaugeTriggered(const RingTrigger *, const RingStats *, int);
+int8_t commandMode(const int16_t *);
+int8_t commandStep(const int16_t *);
+int8_t commandGoto(const int16_t *);
+int8_t commandStop(const int16_t *);
+int8_t commandPixel(const int16_t *);
+int8_t commandDigits(const int16_t *);
+int8_t commandLog(const int16_t *);
+int8_t commandStats(const int16_t *);
+void telemetrySendTasks();
+int8_t commandLatency(const int16_t *);
+void telemetrySendLatency();
+#ifdef TRACE
+int8_t commandTrace(const int16_t *);
+void telemetrySendTrace();
+#endif
+void stepperAbort();
 
 
 
-QueueHandle_t leftDigQueue = 0;
-QueueHandle_t rightDigQueue = 0;
-QueueHandle_t tempOrHumQueue = 0;
 QueueHandle_t stepperQueue = 0;
 QueueHandle_t pixelCommandQueue = 0;
 
-SemaphoreHandle_t xBinarySemaphore;
-
-TaskHandle_t LeftTask_Handle;
-TaskHandle_t RightTask_Handle;
+// everything the kernel needs is allocated here, so the linker map shows all of it
+StaticQueue_t stepperQueueBuffer;
+uint8_t stepperQueueStorage[2 * sizeof(MotionCommand)];
+StaticQueue_t pixelCommandQueueBuffer;
+uint8_t pixelCommandQueueStorage[sizeof(PixelCommand)];
+
+#ifdef BENCHMARK
+StaticTask_t benchTcb;
+StackType_t benchStack[BENCH_STACK];
+#else
+StaticTask_t dipTcb;
+StackType_t dipStack[DIP_STACK];
+StaticTask_t stepperTcb;
+StackType_t stepperStack[STEPPER_STACK];
+StaticTask_t pixelTcb;
+StackType_t pixelStack[PIXEL_STACK];
+StaticTask_t sensorTcb;
+StackType_t sensorStack[SENSOR_STACK];
+StaticTask_t telemetryTcb;
+StackType_t telemetryStack[TELEMETRY_STACK];
+StaticTask_t commandTcb;
+StackType_t commandStack[COMMAND_STACK];
+#endif
 
-ClosedCube_HDC1080 hdc1080;
+// serial commands, "mode -1" goes back to the dips
+const CommandDescriptor commandTable[] PROGMEM = {
+  { "mode",   1, commandMode },    // mode <0 - 24 | -1>
+  { "step",   1, commandStep },    // step <steps>, negative is CCW
+  { "goto",   1, commandGoto },    // goto <position>
+  { "stop",   0, commandStop },
+  { "pixel",  1, commandPixel },   // pixel <0 - 11 | -1>, as pixelCommand(), -1 stops the effect
+  { "digits", 2, commandDigits },  // digits <left glyph> <right glyph>
+  { "log",    1, commandLog },     // log <0 - 2>
+  { "stats",  0, commandStats },   // per task CPU and stack use, also sent every second at log level 2
+  { "latency", 0, commandLatency }, // input to output latency histograms, one per mode that has samples
+#ifdef TRACE
+  { "trace",  0, commandTrace }    // dumps the trace ring, the _trace builds only
+#endif
+};
+
+// gauge triggers in hundredths of a unit. DELTA is measured against the reading the gauge shows
+const RingTrigger tempTriggers[GAUGE_TRIGGERS] = {
+  { RING_TRIGGER_DELTA, 50 },   // smoothed temperature half a degree off the gauge
+  { RING_TRIGGER_RATE, 100 }    // or moving faster than a degree a minute, then it tracks closely
+};
+const RingTrigger humTriggers[GAUGE_TRIGGERS] = {
+  { RING_TRIGGER_DELTA, 200 },  // smoothed humidity 2 %RH off the gauge
+  { RING_TRIGGER_RATE, 500 }    // or moving faster than 5 %RH a minute
+};
+
+TaskHandle_t DipTask_Handle;
+TaskHandle_t PixelTask_Handle;
+TaskHandle_t StepperTask_Handle;
+TaskHandle_t SensorTask_Handle;
+TaskHandle_t TelemetryTask_Handle;
+TaskHandle_t CommandTask_Handle;
+
+volatile uint8_t modeOverride = MODE_NONE; // set by the mode command, MODE_NONE follows the dips
+volatile bool taskStatsWanted = false;     // set by the stats command, vTelemetry sends them once
+volatile bool latencyWanted = false;       // set by the latency command, vTelemetry sends them once
+#ifdef TRACE
+volatile bool traceWanted = false;         // set by the trace command, vTelemetry dumps the ring once
+#endif
 
-Stepper step_motor(2048, 24, 28, 26, 30);
+// indexed by modeIndex(), the comments are dips 1 - 4 or dips 6 - 8
+const ModeDescriptor modeTable[MODE_COUNT] PROGMEM = {
+  { modeTempEntry,         modeTempPeriodic,         NULL,                0 },                       // 0, 0, 0, 0
+  { modeStopEntry,         NULL,                     NULL,                0 },                       // 0, 0, 0, 1
+  { modeCcwEntry,          modeCcwPeriodic,          NULL,                0 },                       // 0, 0, 1, 0
+  { modeStopEntry,         NULL,                     NULL,                0 },                       // 0, 0, 1, 1
+  { modeCwEntry,           modeCwPeriodic,           NULL,                0 },                       // 0, 1, 0, 0
+  { modeStopEntry,         NULL,                     NULL,                0 },                       // 0, 1, 0, 1
+  { NULL,                  modeBackForthPeriodic,    NULL,                0 },                       // 0, 1, 1, 0
+  { modeStopEntry,         NULL,                     NULL,                0 },                       // 0, 1, 1, 1
+  { modeHumEntry,          modeHumPeriodic,          NULL,                0 },                       // 1, 0, 0, 0
+  { modeStopEntry,         NULL,                     NULL,                0 },                       // 1, 0, 0, 1
+  { modeCcwEntry,          modeCcwPeriodic,          NULL,                0 },                       // 1, 0, 1, 0
+  { modeStopEntry,         NULL,                     NULL,                0 },                       // 1, 0, 1, 1
+  { modeCwEntry,           modeCwPeriodic,           NULL,                0 },                       // 1, 1, 0, 0
+  { modeStopEntry,         NULL,                     NULL,                0 },                       // 1, 1, 0, 1
+  { NULL,                  modeBackForthPeriodic,    NULL,                0 },                       // 1, 1, 1, 0
+  { modeStopEntry,         NULL,                     NULL,                0 },                       // 1, 1, 1, 1
+  { modePixelRedEntry,     modePixelRedPeriodic,     NULL,                INPUT_EVT_BUTTON3_DOWN },  // 0, 0, 0
+  { modePixelGreenEntry,   NULL,                     NULL,                0 },                       // 0, 0, 1
+  { modePixelBlueEntry,    NULL,                     NULL,                0 },                       // 0, 1, 0
+  { modePixelWhiteEntry,   NULL,                     NULL,                0 },                       // 0, 1, 1
+  { modePixelColorsEntry,  NULL,                     NULL,                0 },                       // 1, 0, 0
+  { modePixelBrightEntry,  NULL,                     NULL,                0 },                       // 1, 0, 1
+  { modePixelPulseEntry,   modePixelPulsePeriodic,   modePixelEffectExit, 0 },                       // 1, 1, 0
+  { modePixelRainbowEntry, modePixelRainbowPeriodic, modePixelEffectExit, 0 },                       // 1, 1, 1
+  { modePixelBlankEntry,   NULL,                     NULL,                0 }                        // button 1 held
+};
 
 
 void setup() {
@@ -112,15 +262,11 @@ void setup() {
     if (F_CPU == 16000000)clock_prescale_set(clock_div_1);
   #endif
   // End of trinket special code
-  strip.setBrightness(BRIGHTNESS);
+  powerBegin(); // unused peripherals off before anything starts
+
   strip.begin();
   strip.show();
 
-  // configures button
-  pinMode(BUTTON1, INPUT);
-  pinMode(BUTTON2, INPUT);
-  pinMode(BUTTON3, INPUT);
-
   // configures pins to be used as outputs for 7 seg display
   pinMode(SevenSegA, OUTPUT);
   pinMode(SevenSegB, OUTPUT);
@@ -135,20 +281,14 @@ void setup() {
   pinMode(SevenSegCC1, OUTPUT); // right digit
   pinMode(SevenSegCC2, OUTPUT); // left digit
 
-  // configures dip switch pins
-  pinMode(DIP1, INPUT);
-  pinMode(DIP2, INPUT);
-  pinMode(DIP3, INPUT);
-  pinMode(DIP4, INPUT);
-  pinMode(DIP5, INPUT);
-  pinMode(DIP6, INPUT);
-  pinMode(DIP7, INPUT);
-  pinMode(DIP8, INPUT);
+  // digits are multiplexed from the timer 3 interrupt from here on
+  sevSegBegin(SEV_SEG_REFRESH_HZ);
 
-  Serial.begin(9600);
+  Serial.begin(TELEMETRY_BAUD);
+  telemetryBegin();
 
-  // initialize HDC1080
-  hdc1080.begin(0x40);
+  // initialize HDC1080, vSensor samples it from here on
+  sensorBegin();
 
    // put your setup code here, to run once:
   while(!Serial)
@@ -156,894 +296,958 @@ void setup() {
     ;
   }
 
-  // step motor set to fast speed.
-  step_motor.setSpeed(1000);
-
-  leftDigQueue = xQueueCreate(5, sizeof (int)); // queues initialized to hold 1 value
-  rightDigQueue = xQueueCreate(5, sizeof (int));
-  stepperQueue = xQueueCreate(2, sizeof (int));
-  pixelCommandQueue = xQueueCreate(4, sizeof (int));
-
-  xBinarySemaphore = xSemaphoreCreateBinary();
-  xSemaphoreGive(xBinarySemaphore);
-
-  xTaskCreate(vDipSwitch, "Dip", 512, NULL, 3, NULL); 
-  xTaskCreate(vSevSegDisplay, "Display", 128, NULL, 1, &LeftTask_Handle);
-  xTaskCreate(vMoveStepper, "Stepper", 1024, NULL, 1, NULL);
-  xTaskCreate(vPixelCommands, "Pixels", 256, NULL, 4, NULL);
+  stepperQueue = xQueueCreateStatic(2, sizeof (MotionCommand), stepperQueueStorage, &stepperQueueBuffer);
+  // a one deep mailbox, the newest pixel command overwrites one that hasn't started yet
+  pixelCommandQueue = xQueueCreateStatic(1, sizeof (PixelCommand), pixelCommandQueueStorage, &pixelCommandQueueBuffer);
+  traceNameQueue(stepperQueue, "stepper");
+  traceNameQueue(pixelCommandQueue, "pixels");
+
+  stepperBegin(STEPPER_ACCEL); // moves are stepped from the timer 4 interrupt
+
+#ifdef BENCHMARK
+  // benchmark build, the suite drives everything itself instead of the dip switch modes
+  PixelTask_Handle = xTaskCreateStatic(vBenchmark, "Bench", BENCH_STACK, NULL, 4, benchStack, &benchTcb);
+  pixelBegin(&strip);
+  runStatsBegin();
+  runStatsWatch(PixelTask_Handle);
+#else
+  DipTask_Handle = xTaskCreateStatic(vDipSwitch, "Dip", DIP_STACK, NULL, 3, dipStack, &dipTcb);
+  StepperTask_Handle = xTaskCreateStatic(vMoveStepper, "Stepper", STEPPER_STACK, NULL, 1, stepperStack, &stepperTcb);
+  PixelTask_Handle = xTaskCreateStatic(vPixelCommands, "Pixels", PIXEL_STACK, NULL, 4, pixelStack, &pixelTcb);
+  SensorTask_Handle = xTaskCreateStatic(vSensor, "Sensor", SENSOR_STACK, NULL, 2, sensorStack, &sensorTcb);
+  TelemetryTask_Handle = xTaskCreateStatic(vTelemetry, "Telemetry", TELEMETRY_STACK, NULL, 1, telemetryStack, &telemetryTcb);
+  CommandTask_Handle = xTaskCreateStatic(vCommand, "Command", COMMAND_STACK, NULL, 2, commandStack, &commandTcb);
+  commandBegin(commandTable, sizeof(commandTable) / sizeof(commandTable[0]));
+
+  // CPU time is counted from the scheduler's task switch hooks
+  runStatsBegin();
+  runStatsWatch(DipTask_Handle);
+  runStatsWatch(StepperTask_Handle);
+  runStatsWatch(PixelTask_Handle);
+  runStatsWatch(SensorTask_Handle);
+  runStatsWatch(TelemetryTask_Handle);
+  runStatsWatch(CommandTask_Handle);
+  pixelBegin(&strip);
+
+  // times each dip or button change to the first output it causes
+  latencyBegin();
+
+  // dips and buttons are debounced from the timer 5 interrupt, vDipSwitch is told when they change
+  inputBegin(DipTask_Handle);
+#endif
 
   vTaskStartScheduler();
 }
 
 void loop() {
-  //not needed in RTOS
+  // the idle hook runs this, so no task is ready. sleeps until the next interrupt
+  powerIdle();
+}
+
+// with static allocation the kernel asks for the idle task's memory too
+void vApplicationGetIdleTaskMemory(StaticTask_t **tcb, StackType_t **stack, uint32_t *stackDepth)
+{
+  static StaticTask_t idleTcb;
+  static StackType_t idleStack[configMINIMAL_STACK_SIZE];
+  *tcb = &idleTcb;
+  *stack = idleStack;
+  *stackDepth = configMINIMAL_STACK_SIZE;
 }
 
+#if configUSE_TIMERS == 1
+void vApplicationGetTimerTaskMemory(StaticTask_t **tcb, StackType_t **stack, uint32_t *stackDepth)
+{
+  static StaticTask_t timerTcb;
+  static StackType_t timerStack[configTIMER_TASK_STACK_DEPTH];
+  *tcb = &timerTcb;
+  *stack = timerStack;
+  *stackDepth = configTIMER_TASK_STACK_DEPTH;
+}
+#endif
+
 /*********************************************************
  * void vDipSwitch(void *pvParameters)
  * 
- * This function runs the dip switch 
+ * This function runs the dip switch. The switches are
+ * turned into a mode number once per pass and looked up
+ * in modeTable. Entry and exit actions only run when the
+ * mode really changes, the periodic action runs every
+ * pass with the input events that woke the task.
  * *******************************************************/
 void vDipSwitch(void *pvParameters)
 {
   (void) pvParameters;
 
-  int stepCount = 0;
-  int i;
-  int x, y;
-  int test = 1;
-  int state = 0;
-  int prevState = -1;
+  uint8_t prevState = MODE_NONE;
+  uint32_t inputEvents = 0;
+  ModeDescriptor mode;
 
-  //delay(5000);
-  // display hex numbers on sevSegment Display
-  /*for(i = 0; i < 256; i++)
-  {
-    x = i / 16;
-    y = i % 16;
-    segManager(x,y);
-    vTaskDelay(100 / portTICK_PERIOD_MS);
-  }*/
-  i = 0;
-  // check dip switches 1,2,3,4
   for(;;)
   {
-    BREAKRAINBOW: if(digitalRead(DIP5) == LOW)
+    // sleeps until a dip or button changes, or for INPUT_IDLE_MS so running modes keep going
+    if(xTaskNotifyWait(0, INPUT_EVT_ALL, &inputEvents, INPUT_IDLE_MS / portTICK_PERIOD_MS) == pdFALSE)
     {
-      if((digitalRead(DIP1) == LOW) && (digitalRead(DIP2) == LOW) && (digitalRead(DIP3) == LOW) && (digitalRead(DIP4) == LOW) && digitalRead(DIP5) == LOW)
-      {
-        state = 0;
-        if(state == prevState)
-        {
-          // do nothing
-        }
-        else
-        {
-          i = 0;
-          int temp1 = 0;
-          int temp2 = 0;
-
-          segManager(0,19); // sets display digits
-          // checkQueueIsFull(test); // checks if queue is full or not
-
-          temp1 = hdc1080.readTemperature();
-          vTaskDelay(500 / portTICK_PERIOD_MS);
-          temp2 = hdc1080.readTemperature();
-          if(temp1 > temp2) // don't do anything if temp if different
-          {
-            Serial.print("T=");
-            Serial.print(temp1); // prints collected temp to serial monitor
-            Serial.println("C");
-          }
-          else if(temp1 < temp2) // don't do anything if temp is different
-          {
-            Serial.print("T=");
-            Serial.print(temp1); // prints collected temp to serial monitor
-            Serial.println("C");
-          }
-          else // print if temp is different
-          {
-            Serial.print("T=");
-            Serial.print(temp1); // prints collected temp to serial monitor
-            Serial.println("C");
-            while(i <= temp1)
-            {
-              stepCount = -1;
-              xQueueSend(stepperQueue, &stepCount, portMAX_DELAY);
-              taskYIELD();
-
-              xSemaphoreGive(xBinarySemaphore);
-              vTaskDelay(1);
-              xSemaphoreTake(xBinarySemaphore, portMAX_DELAY);
-              i++;
-            }
-          }
-          prevState = state;
-          Serial.println(state);
-        }
-        // (0,0,0,0)
-      }
-      else if((digitalRead(DIP1) == LOW) && (digitalRead(DIP2) == LOW) && (digitalRead(DIP3) == LOW) && (digitalRead(DIP4) == HIGH))
-      {
-        segManager(5, 19);
-        checkQueueIsFull(test);
-        Serial.println("Stop");
-
-        // DO NOTHING 
-        // (0,0,0,1)
-      }
-      else if((digitalRead(DIP1) == LOW) && (digitalRead(DIP2) == LOW) && (digitalRead(DIP3) == HIGH) && (digitalRead(DIP4) == LOW))
-      {
-        segManager(3, 16);
-        while(i <= 2048 && digitalRead(DIP1) == LOW && digitalRead(DIP2) == LOW && digitalRead(DIP3) == HIGH && digitalRead(DIP4) == LOW)
-        {
-          stepCount = -1; // stepper motor direction CCW
-          xQueueSend(stepperQueue, &stepCount, portMAX_DELAY); // sends direction to motor task
-          taskYIELD();
-
-          xSemaphoreGive(xBinarySemaphore);
-          vTaskDelay(1);
-          xSemaphoreTake(xBinarySemaphore, portMAX_DELAY);
-          i++;
-        }
-        i=0;
-        // (0,0,1,0)
-      }
-      else if((digitalRead(DIP1) == LOW) && (digitalRead(DIP2) == LOW) && (digitalRead(DIP3) == HIGH) && (digitalRead(DIP4) == HIGH))
-      {
-        segManager(5, 19);
-        checkQueueIsFull(test);
-        Serial.println("Stop");
+      inputEvents = 0; // timed out, nothing changed
+    }
 
-        // DO NOTHING 
-        // (0,0,1,1)
-      }
-      else if((digitalRead(DIP1) == LOW) && (digitalRead(DIP2) == HIGH) && (digitalRead(DIP3) == LOW) && (digitalRead(DIP4) == LOW))
+    uint8_t state = modeIndex();
+    // a change is timed if it switches the mode or the mode has an output for it,
+    // one that does neither is counted as ignored
+    bool answered = inputEvents != 0 && (state != prevState || (inputEvents & mode.answers) != 0);
+    if(answered)
+    {
+      latencyAnswerBegin();
+    }
+    else if(inputEvents != 0)
+    {
+      latencyIgnore();
+    }
+    if(state != prevState)
+    {
+      if(prevState != MODE_NONE)
       {
-        segManager(2,17);
-        while(i <= 2048 && digitalRead(DIP1) == LOW && digitalRead(DIP2) == HIGH && digitalRead(DIP3) == LOW && digitalRead(DIP4) == LOW)
+        memcpy_P(&mode, &modeTable[prevState], sizeof(ModeDescriptor));
+        if(mode.exit != NULL)
         {
-          stepCount = 1;
-          xQueueSend(stepperQueue, &stepCount, portMAX_DELAY);
-          taskYIELD();
-
-          xSemaphoreGive(xBinarySemaphore);
-          vTaskDelay(1);
-          xSemaphoreTake(xBinarySemaphore, portMAX_DELAY);
-          i++;
+          mode.exit();
         }
-        i = 0;
-        // (0,1,0,0)
       }
-      else if((digitalRead(DIP1) == LOW) && (digitalRead(DIP2) == HIGH) && (digitalRead(DIP3) == LOW) && (digitalRead(DIP4) == HIGH))
+      memcpy_P(&mode, &modeTable[state], sizeof(ModeDescriptor));
+      latencySetMode(state);
+      if(mode.entry != NULL)
       {
-        segManager(5,19);
-        checkQueueIsFull(test);
-        Serial.println("Stop");
-        
-        // DO NOTHING 
-        // (0,1,0,1)
+        mode.entry();
       }
-      else if((digitalRead(DIP1) == LOW) && (digitalRead(DIP2) == HIGH) && (digitalRead(DIP3) == HIGH) && (digitalRead(DIP4) == LOW))
-      {
-        //Serial.println("Move CW then CCW"); 
-        //checkQueueIsFull(test);
-        segManager(4, 17);
-        while(i <= 2048 && digitalRead(DIP1) == HIGH && digitalRead(DIP2) == LOW && digitalRead(DIP3) == LOW && digitalRead(DIP4) == LOW)
-        {
-          stepCount = 1;
-          xQueueSend(stepperQueue, &stepCount, portMAX_DELAY);
-          taskYIELD();
-
-          xSemaphoreGive(xBinarySemaphore);
-          vTaskDelay(1);
-          xSemaphoreTake(xBinarySemaphore, portMAX_DELAY);
-          i++;
-        }
-        i = 0;
-        segManager(4, 16);
+      prevState = state;
+    }
+    if(mode.periodic != NULL)
+    {
+      mode.periodic(inputEvents);
+    }
+    if(answered)
+    {
+      latencyAnswerEnd();
+    }
+  }
+}
 
-        while(i <= 2048 && digitalRead(DIP1) == LOW && digitalRead(DIP2) == HIGH && digitalRead(DIP3) == HIGH && digitalRead(DIP4) == LOW)
-        {
-          stepCount = -1;
-          xQueueSend(stepperQueue, &stepCount, portMAX_DELAY);
-          taskYIELD();
-
-          xSemaphoreGive(xBinarySemaphore);
-          vTaskDelay(1);
-          xSemaphoreTake(xBinarySemaphore, portMAX_DELAY);
-          i++;
-        }
-        i = 0;
-        // (0,1,1,0)
-      }
-      else if((digitalRead(DIP1) == LOW) && (digitalRead(DIP2) == HIGH) && (digitalRead(DIP3) == HIGH) && (digitalRead(DIP4) == HIGH))
-      {
-        segManager(5,19);
-        checkQueueIsFull(test);
-        Serial.println("Stop");
-        // DO NOTHING 
-        // (0,1,1,1)
-      }
-      else if((digitalRead(DIP1) == HIGH) && (digitalRead(DIP2) == LOW) && (digitalRead(DIP3) == LOW) && (digitalRead(DIP4) == LOW))
-      {
-          int hum1 = 0;
-          int hum2 = 0;
-          i = 0;
-
-          segManager(1, 17);
-          checkQueueIsFull(test);
-          
-          hum1 = hdc1080.readHumidity();
-          
-          vTaskDelay(500 / portTICK_PERIOD_MS); // delay between readings to find note change in temps
-
-          hum2 = hdc1080.readHumidity();
-
-          if(hum2 > hum1 + 2) // move on humidity change
-          {
-            Serial.print("RH=");
-            Serial.print(hum1);
-            Serial.println("%");
-            while(i <= hum1)
-            {
-              stepCount = 1;
-              xQueueSend(stepperQueue, &stepCount, portMAX_DELAY);
-              taskYIELD();
-
-              xSemaphoreGive(xBinarySemaphore);
-              vTaskDelay(1);
-              xSemaphoreTake(xBinarySemaphore, portMAX_DELAY);
-              i++;
-            }
-          }
-          else if(hum2 < hum1 - 2) // move on humidity change
-          {
-            Serial.print("RH=");
-            Serial.print(hum1);
-            Serial.println("%");
-            while(i <= hum1)
-            {
-              //Serial.println("check if it gets to the while loop");
-              stepCount = 1;
-              xQueueSend(stepperQueue, &stepCount, portMAX_DELAY);
-              taskYIELD();
-
-              xSemaphoreGive(xBinarySemaphore);
-              vTaskDelay(1);
-              xSemaphoreTake(xBinarySemaphore, portMAX_DELAY);
-              i++;
-            }
-          }
-          else // don't move on humidity change
-          {
-            Serial.print("RH=");
-            Serial.print(hum1);
-            Serial.println("%");
-          }
-        i = 0;
-        // (1,0,0,0)
-      }
-      else if((digitalRead(DIP1) == HIGH) && (digitalRead(DIP2) == LOW) && (digitalRead(DIP3) == LOW) && (digitalRead(DIP4) == HIGH))
-      {
-        segManager(5,19);
-        checkQueueIsFull(test);
-        Serial.println("Stop");
-        // DO NOTHING 
-        // (1,0,0,1)
-      }
-      else if((digitalRead(DIP1) == HIGH) && (digitalRead(DIP2) == LOW) && (digitalRead(DIP3) == HIGH) && (digitalRead(DIP4) == LOW))
-      { 
-        segManager(3, 16);
-        while(i <= 2048 && digitalRead(DIP1) == HIGH && digitalRead(DIP2) == LOW && digitalRead(DIP3) == HIGH && digitalRead(DIP4) == LOW)
-        {
-          stepCount = -1;
-          xQueueSend(stepperQueue, &stepCount, portMAX_DELAY);
-          taskYIELD();
-
-          xSemaphoreGive(xBinarySemaphore);
-          vTaskDelay(1);
-          xSemaphoreTake(xBinarySemaphore, portMAX_DELAY);
-          i++;
-        }
-        i = 0;
-        // (1,0,1,0)
-      }
-      else if((digitalRead(DIP1) == HIGH) && (digitalRead(DIP2) == LOW) && (digitalRead(DIP3) == HIGH) && (digitalRead(DIP4) == HIGH))
-      {
-        segManager(5, 19);
-        checkQueueIsFull(test);
-        Serial.println("Stop");
-        // DO NOTHING 
-        // (1,0,1,1)
-      }
-      else if((digitalRead(DIP1) == HIGH) && (digitalRead(DIP2) == HIGH) && (digitalRead(DIP3) == LOW) && (digitalRead(DIP4) == LOW))
-      {
-        segManager(2, 17);
-        while(i <= 2048 && digitalRead(DIP1) == HIGH && digitalRead(DIP2) == HIGH && digitalRead(DIP3) == LOW && digitalRead(DIP4) == LOW)
-        {
-          //Serial.println("check if it gets to the while loop");
-          stepCount = 1;
-          xQueueSend(stepperQueue, &stepCount, portMAX_DELAY);
-          taskYIELD();
-
-          xSemaphoreGive(xBinarySemaphore);
-          vTaskDelay(1);
-          xSemaphoreTake(xBinarySemaphore, portMAX_DELAY);
-          i++;
-        }
-        i = 0;
-        // (1,1,0,0)
-      }
-      else if((digitalRead(DIP1) == HIGH) && (digitalRead(DIP2) == HIGH) && (digitalRead(DIP3) == LOW) && (digitalRead(DIP4) == HIGH))
-      {
-        segManager(5,19);
-        checkQueueIsFull(test);
-        Serial.println("Stop");
-        // DO NOTHING 
-        // (1,1,0,1)
-      }
-      else if((digitalRead(DIP1) == HIGH) && (digitalRead(DIP2) == HIGH) && (digitalRead(DIP3) == HIGH) && (digitalRead(DIP4) == LOW))
-      { 
-        //checkQueueIsFull(test);
-        i = 0;
-        segManager(4, 17);
+// the mode command overrides everything, otherwise
+// dip switches 1 - 4 decide the mode while dip 5 is off,
+// dips 6 - 8 pick the pixel mode while it is on, and button 1 blanks the pixels
+uint8_t modeIndex()
+{
+  uint8_t forced = modeOverride;
+  if(forced != MODE_NONE)
+  {
+    return forced;
+  }
+  uint8_t dips = inputDips();
+  if(inputDip(5) == LOW)
+  {
+    return dips >> 4;
+  }
+  if(inputButton(INPUT_BUTTON1) == HIGH)
+  {
+    return MODE_PIXEL_BLANK;
+  }
+  return MODE_PIXEL + (dips & 0x07);
+}
 
-        while (i <= 2048 && digitalRead(DIP1) == HIGH && digitalRead(DIP2) == HIGH && digitalRead(DIP3) == HIGH && digitalRead(DIP4) == LOW)
-        {
-          stepCount = 1;
-          xQueueSend(stepperQueue, &stepCount, portMAX_DELAY);
-          taskYIELD();
-
-          xSemaphoreGive(xBinarySemaphore);
-          vTaskDelay(1);
-          xSemaphoreTake(xBinarySemaphore, portMAX_DELAY);
-          i++;
-        }
-        segManager(4, 16);
-        i = 0;
-        while(i <= 2048 && digitalRead(DIP1) == HIGH && digitalRead(DIP2) == HIGH && digitalRead(DIP3) == HIGH && digitalRead(DIP4) == LOW)
-        {
-          stepCount = -1;
-          xQueueSend(stepperQueue, &stepCount, portMAX_DELAY);
-          taskYIELD();
-
-          xSemaphoreGive(xBinarySemaphore);
-          vTaskDelay(1);
-          xSemaphoreTake(xBinarySemaphore, portMAX_DELAY);
-          i++;
-        }
-        i = 0;
-        // (1,1,1,0)
-      }
-      else
-      {
-        segManager(5,19);
-        checkQueueIsFull(test);
-        Serial.println("Stop");
-        // DO NOTHING 
-        // (1,1,1,1)
-      }
-    }else
-    { 
-      int lastState = LOW;
-      int lastState2 = LOW;
-      int lastState3 = LOW;
-      int currentState, currentState2, currentState3;
-      int counter; //= 0;
-      currentState = digitalRead(BUTTON1);
-      currentState3 = digitalRead(BUTTON3);
-      if(currentState == LOW) // button1 not pressed goes into regular routine
-      {
-        // sets all LED's to red.
-        // on button 3 press, shows individual control of LED's
-        if(digitalRead(DIP6) == LOW && digitalRead(DIP7) == LOW && digitalRead(DIP8) == LOW) // dips set to 0, 0, 0 
-        {
-          state = 2;
-          if(state == prevState)
-          {
-            // do nothing
-          }
-          else
-          {
-            if(currentState3 == HIGH)
-            {
-              pixelManager(7);
-              vTaskDelay(500 / portTICK_PERIOD_MS);
-              pixelManager(8);
-              vTaskDelay(500 / portTICK_PERIOD_MS);
-              pixelManager(9);
-              vTaskDelay(500 / portTICK_PERIOD_MS);
-              pixelManager(0);
-              vTaskDelay(500 / portTICK_PERIOD_MS);
-              pixelManager(9);
-              vTaskDelay(500 / portTICK_PERIOD_MS);
-              pixelManager(8);
-              vTaskDelay(500 / portTICK_PERIOD_MS);
-              pixelManager(7);
-              vTaskDelay(500 / portTICK_PERIOD_MS);
-            }
-            else
-            {
-              pixelManager(0);
-            }
-          }
-          prevState = state;
-          //Serial.print("State ");
-          //Serial.println(state);
-          //Serial.print("PrevState ");
-          //Serial.println(prevState);
-    
-          //Serial.println(counter);
-        }
-        // sets all LED's to green
-        else if(digitalRead(DIP6) == LOW && digitalRead(DIP7) == LOW && digitalRead(DIP8) == HIGH) // 0, 0, 1
-        {
-          pixelManager(1);
-        }
-        // sets all LEDS to blue
-        else if(digitalRead(DIP6) == LOW && digitalRead(DIP7) == HIGH && digitalRead(DIP8) == LOW) // 0, 1, 0
-        {
-          pixelManager(2);
-        }
-        // sets all LEDS to white
-        else if(digitalRead(DIP6) == LOW && digitalRead(DIP7) == HIGH && digitalRead(DIP8) == HIGH) // 0, 1, 1
-        {
-          pixelManager(3);
-        }
-        // sets LED's to different colors
-        else if(digitalRead(DIP6) == HIGH && digitalRead(DIP7) == LOW && digitalRead(DIP8) == LOW) // 1, 0, 0
-        {
-          pixelManager(4);
-        }
-        // sets each LED brightness unique
-        else if(digitalRead(DIP6) == HIGH && digitalRead(DIP7) == LOW && digitalRead(DIP8) == HIGH) // 1, 0, 1
-        {
-          pixelManager(5);
-        }
-        // sets pulse white
-        else if(digitalRead(DIP6) == HIGH && digitalRead(DIP7) == HIGH && digitalRead(DIP8) == LOW) // 1, 1, 0
-        {
-          //pixelManager(6);
-          if(pixelManager(11) == 1)
-          {
-            goto BREAKRAINBOW; // YIKES. Rework code to get rid of goto. its late so i don't feel like it right now. 
-          }
-        }
-        // rainbow command
-        else // 1, 1, 1
-        {
-          if(pixelManager(6) == 1)
-          {
-            goto BREAKRAINBOW; // YIKES. Rework code to get rid of goto. its late so i don't feel like it right now.
-          }
-        }
-      }
-      else // button1 is HIGH so blanks screen for a short time and resets to whatever the switch is set to.
-      {
-        while(currentState == HIGH)
-        {
-          pixelManager(10);
-          lastState = currentState;
-          vTaskDelay(500 / portTICK_PERIOD_MS);
-          currentState = digitalRead(BUTTON1);
-        }
-      }
-      
-    } state = prevState;
+// (0,0,0,0) temperature gauge
+void modeTempEntry()
+{
+  setDigits(0, 19);
+}
+
+void modeTempPeriodic(uint32_t events)
+{
+  (void) events;
+  static uint16_t lastSeq = 0;
+  SensorSnapshot snap;
+
+  if(!sensorRead(&snap) || snap.seq == lastSeq) // nothing new from vSensor yet
+  {
+    return;
+  }
+  lastSeq = snap.seq;
+  uint16_t target = gaugePosition(snap.tempStats.ewma, TEMP_STEPS_PER_DEG);
+  if(target != stepperPosition() && gaugeTriggered(tempTriggers, &snap.tempStats, TEMP_STEPS_PER_DEG)) // only move the gauge on a real trend
+  {
+    logEvent(LOG_INFO, LOG_EVT_TEMP, snap.tempStats.ewma);
+    stepperMoveToPosition(target, modeIndex());
   }
 }
 
-/*******************************************************
- * void vSevSegDisplay(void *pvParameters)
- * 
- *  Task to display digits on seven seg display 
- * ****************************************************/
-void vSevSegDisplay(void *pvParameters)
+// (1,0,0,0) humidity gauge
+void modeHumEntry()
 {
-  (void) pvParameters;
-  int num = 0, num2 = 0;
-  for(;;)
+  setDigits(1, 17);
+}
+
+void modeHumPeriodic(uint32_t events)
+{
+  (void) events;
+  static uint16_t lastSeq = 0;
+  SensorSnapshot snap;
+
+  if(!sensorRead(&snap) || snap.seq == lastSeq) // nothing new from vSensor yet
+  {
+    return;
+  }
+  lastSeq = snap.seq;
+  uint16_t target = gaugePosition(snap.humStats.ewma, HUM_STEPS_PER_PCT);
+  if(target != stepperPosition() && gaugeTriggered(humTriggers, &snap.humStats, HUM_STEPS_PER_PCT))
+  {
+    logEvent(LOG_INFO, LOG_EVT_HUM, snap.humStats.ewma);
+    stepperMoveToPosition(target, modeIndex());
+  }
+}
+
+// every mode with dip 4 set, and (1,1,1,1)
+void modeStopEntry()
+{
+  setDigits(5, 19);
+  logEvent(LOG_INFO, LOG_EVT_STOP, 0);
+}
+
+// (0,0,1,0) and (1,0,1,0) spin CCW
+void modeCcwEntry()
+{
+  setDigits(3, 16);
+}
+
+void modeCcwPeriodic(uint32_t events)
+{
+  (void) events;
+  stepperMove(-1, 2049, modeIndex()); // stepper motor direction CCW
+}
+
+// (0,1,0,0) and (1,1,0,0) spin CW
+void modeCwEntry()
+{
+  setDigits(2, 17);
+}
+
+void modeCwPeriodic(uint32_t events)
+{
+  (void) events;
+  stepperMove(1, 2049, modeIndex());
+}
+
+// (0,1,1,0) and (1,1,1,0) CW then CCW
+void modeBackForthPeriodic(uint32_t events)
+{
+  (void) events;
+  setDigits(4, 17);
+  if(stepperMove(1, 2049, modeIndex()))
   {
-    Serial.println("Sev Seg");
-    xQueueReceive(leftDigQueue, &num, portMAX_DELAY); // receives left digit from queue
-    xSemaphoreTake(xBinarySemaphore,portMAX_DELAY);
-    printSevSeg(SevenSegCC2, SevenSegCC1, num);
-    xQueueReceive(rightDigQueue, &num2, portMAX_DELAY); // receives right digit from queue
-    printSevSeg(SevenSegCC1, SevenSegCC2, num2);
-    xSemaphoreGive(xBinarySemaphore);
-    Serial.println("SevSeg Gave Semaphore");
+    setDigits(4, 16);
+    stepperMove(-1, 2049, modeIndex());
   }
 }
 
+// (0,0,0) all red, button 3 shows individual control of the LEDs
+void modePixelRedEntry()
+{
+  pixelManager(0);
+}
+
+void modePixelRedPeriodic(uint32_t events)
+{
+  if(events & INPUT_EVT_BUTTON3_DOWN)
+  {
+    pixelManager(7);
+    vTaskDelay(500 / portTICK_PERIOD_MS);
+    pixelManager(8);
+    vTaskDelay(500 / portTICK_PERIOD_MS);
+    pixelManager(9);
+    vTaskDelay(500 / portTICK_PERIOD_MS);
+    pixelManager(0);
+    vTaskDelay(500 / portTICK_PERIOD_MS);
+    pixelManager(9);
+    vTaskDelay(500 / portTICK_PERIOD_MS);
+    pixelManager(8);
+    vTaskDelay(500 / portTICK_PERIOD_MS);
+    pixelManager(7);
+    vTaskDelay(500 / portTICK_PERIOD_MS);
+  }
+}
+
+void modePixelGreenEntry()   { pixelManager(1); } // 0, 0, 1
+void modePixelBlueEntry()    { pixelManager(2); } // 0, 1, 0
+void modePixelWhiteEntry()   { pixelManager(3); } // 0, 1, 1
+void modePixelColorsEntry()  { pixelManager(4); } // 1, 0, 0 different colors
+void modePixelBrightEntry()  { pixelManager(5); } // 1, 0, 1 each LED brightness unique
+void modePixelBlankEntry()   { pixelManager(10); } // button 1 held
+void modePixelPulseEntry()   { pixelManager(11); } // 1, 1, 0
+void modePixelRainbowEntry() { pixelManager(6); }  // 1, 1, 1
+
+// 1, 1, 0 pulse white and 1, 1, 1 rainbow start their effect again once the last one is done
+void modePixelPulsePeriodic(uint32_t events)
+{
+  (void) events;
+  if(!pixelBusy())
+  {
+    pixelManager(11);
+  }
+}
+
+void modePixelRainbowPeriodic(uint32_t events)
+{
+  (void) events;
+  if(!pixelBusy())
+  {
+    pixelManager(6);
+  }
+}
+
+// stops the effect so a mode that doesn't use the pixels doesn't leave it running.
+// vPixelCommands outranks vDipSwitch, so the stop runs as soon as it is posted and
+// a pixel mode's entry command then starts its effect from a stopped strip
+void modePixelEffectExit()
+{
+  pixelManager(PIXEL_CMD_STOP);
+}
+
+
 /****************************************************
  * void vMoveStepper(void *pvParameters)
  * 
- *  Task to move stepper motor
+ *  Task to hand motion commands to the stepper driver
  * *************************************************/
 void vMoveStepper(void *pvParameters)
 {
   (void) pvParameters;
-  int num_steps = 0;
+  MotionCommand cmd;
   for(;;)
   {
-    Serial.println("Stepper");
-    if(!xQueueReceive(stepperQueue, &num_steps, portMAX_DELAY))
+    if(!xQueueReceive(stepperQueue, &cmd, portMAX_DELAY))
     {
-      Serial.println("Task Not received.");
+      logEvent(LOG_ERROR, LOG_EVT_QUEUE_ERROR, 0);
+      continue;
+    }
+    if(cmd.abort)
+    {
+      stepperStop(); // ramps down, the interrupt tells the move's task once stopped
+      continue;
+    }
+    logEvent(LOG_DEBUG, LOG_EVT_STEPPER, cmd.steps);
+    if(cmd.absolute)
+    {
+      stepperMoveTo(cmd.steps, STEPPER_RPM_TO_SPS(cmd.speed), cmd.notify, cmd.cause);
+    }
+    else
+    {
+      stepperStart(cmd.direction, cmd.steps, STEPPER_RPM_TO_SPS(cmd.speed), cmd.notify, cmd.cause); // interrupt notifies cmd.notify when finished
     }
-    step_motor.step(num_steps); //move stepper number of steps
-    taskYIELD();
   }
 }
 
 /***************************************************
  * void vPixelCommands(void *pvParameters)
  *
- *  Task to give commands to display pixel colors
+ *  Task that owns the pixels. It advances the running
+ *  effect one frame at a time and waits for the next
+ *  frame on the command mailbox, so a new command
+ *  replaces the effect at the next frame boundary
  * *************************************************/
 void vPixelCommands(void *pvParameters)
 {
   (void) pvParameters;
-  int command = 0;
+  PixelCommand cmd;
+  TickType_t wait = portMAX_DELAY;
   for(;;)
   {
-    //Serial.println("Pixels");
-    if(!xQueueReceive(pixelCommandQueue, &command, portMAX_DELAY))
+    if(xQueueReceive(pixelCommandQueue, &cmd, wait))
     {
-      Serial.println("Pixel Queue not receiving");
+      logEvent(LOG_DEBUG, LOG_EVT_PIXELS, cmd.command);
+      pixelCommand(cmd.command, cmd.cause);
     }
-    Serial.println("Pixels");
-    displayPixelCommand(PIN, command);
-    //xSemaphoreTake(xBinarySemaphore, portMAX_DELAY);
-    //displayPixelCommand(PIN, command);
-    //xSemaphoreGive(xBinarySemaphore);
-    //Serial.println("Pixel gave semaphore");
-    //taskYIELD();
+    wait = pixelStep();
   }
 }
 
-// function to display pixel Command
-void displayPixelCommand(int pixFlag, int command) // display command
+/***************************************************
+ * void vSensor(void *pvParameters)
+ *
+ *  Task that samples the HDC1080 every
+ *  SENSOR_PERIOD_MS. It sleeps through the conversion
+ *  instead of busy waiting, and the modes read the
+ *  snapshot it publishes without touching the bus
+ * *************************************************/
+void vSensor(void *pvParameters)
 {
-  //digitalWrite(pixFlag, HIGH);
-  pixelCommand(command);
-  vTaskDelay(FRAME_RATE);
-  //digitalWrite(pixFlag, HIGH);
+  (void) pvParameters;
+  TickType_t lastWake = xTaskGetTickCount();
+  for(;;)
+  {
+    if(!sensorTrigger())
+    {
+      logEvent(LOG_ERROR, LOG_EVT_SENSOR, 0);
+    }
+    else
+    {
+      // rounded up to whole ticks, +1 because the first tick of a delay can be almost over already
+      vTaskDelay((SENSOR_CONVERSION_MS + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS + 1);
+      if(!sensorCollect())
+      {
+        // NACKed while still converting, one more tick then the sample is lost
+        vTaskDelay(1);
+        if(!sensorCollect())
+        {
+          logEvent(LOG_ERROR, LOG_EVT_SENSOR, 1);
+        }
+      }
+    }
+    vTaskDelayUntil(&lastWake, SENSOR_PERIOD_MS / portTICK_PERIOD_MS);
+  }
 }
 
-// function to manage pixel commands
-int pixelManager(int pix)
+/***************************************************
+ * void vTelemetry(void *pvParameters)
+ *
+ *  The only task that writes to Serial. Sends log
+ *  events as the other tasks queue them and a status
+ *  frame every TELEMETRY_PERIOD_MS
+ * *************************************************/
+void vTelemetry(void *pvParameters)
 {
-  xQueueSend(pixelCommandQueue, &pix, portMAX_DELAY);
-  //taskYIELD();
+  (void) pvParameters;
+  const TickType_t period = TELEMETRY_PERIOD_MS / portTICK_PERIOD_MS;
+  TickType_t lastStatus = xTaskGetTickCount();
+  for(;;)
+  {
+    TickType_t elapsed = xTaskGetTickCount() - lastStatus;
+    telemetryDrainLog(elapsed < period ? period - elapsed : 0);
+
+    if(taskStatsWanted)
+    {
+      taskStatsWanted = false;
+      telemetrySendTasks();
+    }
+    if(latencyWanted)
+    {
+      latencyWanted = false;
+      telemetrySendLatency();
+    }
+#ifdef TRACE
+    if(traceWanted)
+    {
+      traceWanted = false;
+      telemetrySendTrace();
+    }
+#endif
+    if(xTaskGetTickCount() - lastStatus < period)
+    {
+      continue;
+    }
+    lastStatus += period;
+    runStatsSample();
+    if(logGetLevel() >= LOG_DEBUG)
+    {
+      telemetrySendTasks();
+    }
+
+    TelemetryStatus status;
+    SensorSnapshot snap;
+    memset(&status, 0, sizeof(status));
+    sensorRead(&snap);
+    status.type = TELEMETRY_STATUS;
+    status.mode = modeIndex();
+    status.dips = inputDips();
+    status.logLevel = logGetLevel();
+    status.stamp = millis();
+    status.sensorSeq = snap.seq;
+    status.temperature = snap.temperature;
+    status.humidity = snap.humidity;
+    status.tempEwma = snap.tempStats.ewma;
+    status.humEwma = snap.humStats.ewma;
+    status.tempSlope = snap.tempStats.slope;
+    status.humSlope = snap.humStats.slope;
+    status.stepperPos = stepperPosition();
+    status.stepperBusy = stepperBusy();
+    telemetrySend((const uint8_t *) &status, sizeof(status));
+  }
 }
 
-// function to change pixels
-int pixelCommand(int command)
+// one TELEMETRY_TASK frame per watched task, from the last runStatsSample(),
+// then the TELEMETRY_FRAMES frame
+void telemetrySendTasks()
 {
-  switch(command)
+  TelemetryTask frame;
+  RunStatsTask stats;
+  uint8_t count = runStatsCount();
+  for(uint8_t i = 0; i < count; i++)
   {
-    case 0: // display all red
-      strip.setPixelColor(0, 255, 0, 0, 0);
-      strip.setPixelColor(1, 255, 0, 0, 0);
-      strip.setPixelColor(2, 255, 0, 0, 0);
-      strip.setPixelColor(3, 255, 0, 0, 0);
-      strip.show();
-      return 0;
-      break;
-    case 1: // display all green
-      strip.setPixelColor(0, 0, 255, 0, 0);
-      strip.setPixelColor(1, 0, 255, 0, 0);
-      strip.setPixelColor(2, 0, 255, 0, 0);
-      strip.setPixelColor(3, 0, 255, 0, 0);
-      strip.show();
-      return 0;
-      break;
-    case 2: // display all blue
-      strip.setPixelColor(0, 0, 0, 255, 0);
-      strip.setPixelColor(1, 0, 0, 255, 0);
-      strip.setPixelColor(2, 0, 0, 255, 0);
-      strip.setPixelColor(3, 0, 0, 255, 0);
-      strip.show();
-      return 0;
-      break;
-    case 3: // display all white
-      strip.setPixelColor(0, 0, 0, 0, 255);
-      strip.setPixelColor(1, 0, 0, 0, 255);
-      strip.setPixelColor(2, 0, 0, 0, 255);
-      strip.setPixelColor(3, 0, 0, 0, 255);
-      strip.show();
-      return 0;
-      break;
-    case 4: // display pix 0 -> red, pix1 -> green, pix2 -> blue, pix3 -> white for a short amount of time then repeat
-      strip.setPixelColor(0, 255, 0, 0, 0);
-      strip.setPixelColor(1, 0, 255, 0, 0);
-      strip.setPixelColor(2, 0, 0, 255, 0);
-      strip.setPixelColor(3, 0, 0, 0, 255);
-      strip.show();
-      return 0;
-      break;
-    case 5: // display individual pixel brightness
-      strip.setPixelColor(0, 63, 0, 0 , 0);
-      strip.setPixelColor(1, 128, 0, 0, 0);
-      strip.setPixelColor(2, 191, 0, 0, 0);
-      strip.setPixelColor(3, 255, 0, 0, 0);
-      strip.show();
-      return 0;
-      break;
-    case 6: // display rainbow affect
-      //rainbow(1);
-      if(rainbowCycle(1) == 1) // case where another dip is turned
-      {
-        return 1;
-      }
-      return 0;
-      break;
-    case 7:
-      strip.setPixelColor(0, 255, 0, 0, 0);
-      strip.setPixelColor(1, 0, 0, 0, 0);
-      strip.setPixelColor(2, 0, 0, 0, 0);
-      strip.setPixelColor(3, 0, 0, 0, 0);
-      strip.show();
-      return 0;
-      break;
-    case 8:
-      strip.setPixelColor(0, 255, 0, 0, 0);
-      strip.setPixelColor(1, 255, 0, 0, 0);
-      strip.setPixelColor(2, 0, 0, 0, 0);
-      strip.setPixelColor(3, 0, 0, 0, 0);
-      strip.show();
-      return 0;
-      break;
-    case 9:
-      strip.setPixelColor(0, 255, 0, 0, 0);
-      strip.setPixelColor(1, 255, 0, 0, 0);
-      strip.setPixelColor(2, 255, 0, 0, 0);
-      strip.setPixelColor(3, 0, 0, 0, 0);
-      strip.show();
-      return 0;
-      break;
-    case 10:
-      colorWipe();
-      return 0;
-      break;
-    case 11:
-      if(pulseWhite(1) == 1)
-      {
-        return 1;
-      }
-      return 0;
-      break;
+    runStatsGet(i, &stats);
+    memset(&frame, 0, sizeof(frame));
+    frame.type = TELEMETRY_TASK;
+    frame.index = i;
+    frame.count = count;
+    strncpy(frame.name, stats.name, sizeof(frame.name) - 1); // names are at most 7 characters anyway
+    frame.cpu = stats.cpu;
+    frame.stackFree = stats.stackFree;
+    frame.idle = runStatsIdle();
+    frame.asleep = runStatsAsleep();
+    telemetrySend((const uint8_t *) &frame, sizeof(frame));
   }
+
+  // and how well the pixel effects kept to their frame rate
+  FramePacerStats pacing;
+  TelemetryFrames frames;
+  pixelPacing(&pacing);
+  frames.type = TELEMETRY_FRAMES;
+  frames.frames = pacing.frames;
+  frames.overruns = pacing.overruns;
+  frames.dropped = pacing.dropped;
+  frames.jitterMean = pacing.jitterMean;
+  frames.jitterMax = pacing.jitterMax;
+  telemetrySend((const uint8_t *) &frames, sizeof(frames));
 }
 
-// Fill the dots one after the other with a color
-void colorWipe(uint32_t c, uint8_t wait) {
-  for(uint16_t i=0; i<strip.numPixels(); i++) {
-    strip.setPixelColor(i, c);
-    strip.show();
-    vTaskDelay(wait); //////////////////////////////
+// one TELEMETRY_LATENCY frame per mode that has taken a sample or missed one
+void telemetrySendLatency()
+{
+  TelemetryLatency frame;
+  LatencyHistogram histogram;
+  for(uint8_t i = 0; i < MODE_COUNT; i++)
+  {
+    latencyGet(i, &histogram);
+    if(latencyCount(&histogram) == 0 && histogram.missed == 0 && histogram.ignored == 0)
+    {
+      continue;
+    }
+    frame.type = TELEMETRY_LATENCY;
+    frame.mode = i;
+    frame.missed = histogram.missed;
+    frame.ignored = histogram.ignored;
+    frame.max = histogram.max;
+    memcpy(frame.buckets, histogram.buckets, sizeof(frame.buckets));
+    telemetrySend((const uint8_t *) &frame, sizeof(frame));
   }
 }
 
-// Input a value 0 to 255 to get a color value.
-// The colours are a transition r - g - b - back to r.
-uint32_t Wheel(byte WheelPos)
+#ifdef TRACE
+/***************************************************
+ * void telemetrySendTrace()
+ *
+ *  Freezes the trace ring and sends it, the names
+ *  of the watched tasks and queues first so the
+ *  host can label the events, then TELEMETRY_TRACE
+ *  frames oldest first. Recording starts over once
+ *  it has all gone out
+ * *************************************************/
+void telemetrySendTrace()
 {
-  WheelPos = 255 - WheelPos;
-  if(WheelPos < 85)
+  traceFreeze();
+
+  TelemetryTraceName name;
+  RunStatsTask stats;
+  for(uint8_t i = 0; i < runStatsCount(); i++)
   {
-    return strip.Color(255 - WheelPos * 3, 0, WheelPos * 3, 0);
+    runStatsGet(i, &stats);
+    memset(&name, 0, sizeof(name));
+    name.type = TELEMETRY_TRACE_NAME;
+    name.kind = TELEMETRY_TRACE_TASK;
+    name.id = i;
+    strncpy(name.name, stats.name, sizeof(name.name) - 1);
+    telemetrySend((const uint8_t *) &name, sizeof(name));
   }
-  if(WheelPos < 170)
+  for(uint8_t i = 0; i < traceQueueCount(); i++)
   {
-    WheelPos -= 85;
-    return strip.Color(0, WheelPos * 3, 255 - WheelPos * 3, 0);
+    memset(&name, 0, sizeof(name));
+    name.type = TELEMETRY_TRACE_NAME;
+    name.kind = TELEMETRY_TRACE_QUEUE;
+    name.id = i;
+    strncpy(name.name, traceQueueName(i), sizeof(name.name) - 1);
+    telemetrySend((const uint8_t *) &name, sizeof(name));
   }
-  WheelPos -= 170;
-  return strip.Color(WheelPos * 3, 255 - WheelPos * 3, 0, 0);
-}
 
-// Slightly different, this makes the rainbow equally distributed throughout
-int rainbowCycle(uint8_t wait) {
-  uint16_t i, j;
-  strip.begin();
-  for(j=0; j<256; j++) { // 5 cycles of all colors on wheel
-    for(i=0; i< strip.numPixels(); i++) {
-      if(digitalRead(BUTTON1) == HIGH) return 0;
-      if(digitalRead(DIP6) == LOW || digitalRead(DIP7) == LOW || digitalRead(DIP8) == LOW) return 1;
-      strip.setPixelColor(i, Wheel(((i * 256 / strip.numPixels()) + j) & 255));
-      //strip.show();
-      //taskYIELD();
+  // an empty ring still sends one frame, so the host knows the dump is over
+  TelemetryTrace frame;
+  uint16_t total = traceCount();
+  uint16_t first = 0;
+  do
+  {
+    frame.type = TELEMETRY_TRACE;
+    frame.count = total - first < TELEMETRY_TRACE_EVENTS ? total - first : TELEMETRY_TRACE_EVENTS;
+    frame.first = first;
+    frame.total = total;
+    for(uint8_t j = 0; j < frame.count; j++)
+    {
+      traceGet(first + j, &frame.events[j]);
     }
-    strip.show();
-    vTaskDelay(wait);
+    telemetrySend((const uint8_t *) &frame, sizeof(frame) - (TELEMETRY_TRACE_EVENTS - frame.count) * sizeof(TraceEvent));
+    first += frame.count;
+  } while(first < total);
+
+  traceRestart();
+}
+
+int8_t commandTrace(const int16_t *argv)
+{
+  (void) argv;
+  traceWanted = true;
+  return COMMAND_OK;
+}
+#endif
+
+/***************************************************
+ * void vCommand(void *pvParameters)
+ *
+ *  Task that runs serial commands. The UART has no
+ *  way to wake a task, so it polls every tick, and
+ *  a host waits for each command's ack before sending
+ *  the next so the 64 byte receive buffer can't fill
+ * *************************************************/
+void vCommand(void *pvParameters)
+{
+  (void) pvParameters;
+  for(;;)
+  {
+    commandPoll();
+    vTaskDelay(1);
   }
 }
 
-// Fill the dots one after the other with a color
-void colorWipe() {
-  for(uint16_t i = 0; i < strip.numPixels(); i++) 
+int8_t commandMode(const int16_t *argv)
+{
+  if(argv[0] < -1 || argv[0] >= MODE_COUNT)
   {
-    strip.setPixelColor(i, strip.Color(0,0,0));
+    return COMMAND_RANGE;
   }
-  strip.show();
+  modeOverride = argv[0] < 0 ? MODE_NONE : argv[0];
+  xTaskNotify(DipTask_Handle, 0, eNoAction); // wakes it with no input events, so the mode change isn't timed as an answer to one
+  return COMMAND_OK;
 }
 
-int pulseWhite(uint8_t wait) {
-  for(int j = 0; j < 256 ; j++){
-      for(uint16_t i=0; i<strip.numPixels(); i++) {
-          if(digitalRead(BUTTON1) == HIGH) return 0;
-          if(digitalRead(DIP6) == LOW || digitalRead(DIP7) == LOW || digitalRead(DIP8) == HIGH) return 1;
-          strip.setPixelColor(i, strip.Color(0,0,0, neopix_gamma[j] ) );
-        }
-        vTaskDelay(wait);
-        strip.show();
-      }
+// the stepper commands queue without waiting for the move, a mode that is
+// moving the stepper will have its move replaced
+int8_t commandStep(const int16_t *argv)
+{
+  MotionCommand cmd = { (int8_t) (argv[0] < 0 ? -1 : 1), (uint16_t) abs(argv[0]), false, STEPPER_RPM, false, NULL, 0 };
+  return xQueueSend(stepperQueue, &cmd, 0) == pdPASS ? COMMAND_OK : COMMAND_BUSY;
+}
 
-  for(int j = 255; j >= 0 ; j--){
-      for(uint16_t i=0; i<strip.numPixels(); i++) {
-          if(digitalRead(BUTTON1) == HIGH) return 0;
-          if(digitalRead(DIP6) == LOW || digitalRead(DIP7) == LOW || digitalRead(DIP8) == HIGH) return 1;
-          strip.setPixelColor(i, strip.Color(0,0,0, neopix_gamma[j] ) );
-        }
-        vTaskDelay(wait);
-        strip.show();
-      }
+int8_t commandGoto(const int16_t *argv)
+{
+  if(argv[0] < 0 || argv[0] >= STEPPER_STEPS_PER_REV)
+  {
+    return COMMAND_RANGE;
+  }
+  MotionCommand cmd = { 0, (uint16_t) argv[0], true, STEPPER_RPM, false, NULL, 0 };
+  return xQueueSend(stepperQueue, &cmd, 0) == pdPASS ? COMMAND_OK : COMMAND_BUSY;
 }
 
-uint8_t red(uint32_t c)
+int8_t commandStop(const int16_t *argv)
 {
-  return (c >> 16);
+  (void) argv;
+  MotionCommand cmd = { 0, 0, false, 0, true, NULL, 0 };
+  return xQueueSend(stepperQueue, &cmd, 0) == pdPASS ? COMMAND_OK : COMMAND_BUSY;
 }
 
-uint8_t green(uint32_t c)
+int8_t commandPixel(const int16_t *argv)
 {
-  return (c >> 8);
+  if(argv[0] < PIXEL_CMD_STOP || argv[0] > 11)
+  {
+    return COMMAND_RANGE;
+  }
+  pixelManager(argv[0]);
+  return COMMAND_OK;
 }
 
-uint8_t blue(uint32_t c)
+int8_t commandDigits(const int16_t *argv)
 {
-  return (c);
+  if(argv[0] < 0 || argv[0] >= GLYPH_COUNT || argv[1] < 0 || argv[1] >= GLYPH_COUNT)
+  {
+    return COMMAND_RANGE;
+  }
+  setDigits(argv[0], argv[1]);
+  return COMMAND_OK;
+}
+
+int8_t commandStats(const int16_t *argv)
+{
+  (void) argv;
+  taskStatsWanted = true;
+  return COMMAND_OK;
 }
 
-// function to switch between digits
-void sevSegNumbers(int num)
+int8_t commandLatency(const int16_t *argv)
 {
-  switch(num) // switches received queue data to display whatever left dig needed
+  (void) argv;
+  latencyWanted = true;
+  return COMMAND_OK;
+}
+
+int8_t commandLog(const int16_t *argv)
+{
+  if(argv[0] < LOG_ERROR || argv[0] > LOG_DEBUG)
   {
-    case 0:
-      printNum0on();
-      printNum0off();
+    return COMMAND_RANGE;
+  }
+  logSetLevel(argv[0]);
+  return COMMAND_OK;
+}
+
+// hands a pixel command to vPixelCommands, never blocks. a command it
+// hasn't picked up yet is replaced
+int pixelManager(int pix)
+{
+  PixelCommand cmd = { pix, latencyCommand() };
+  return xQueueOverwrite(pixelCommandQueue, &cmd);
+}
+
+// fixed patterns for the pixel commands that aren't one colour
+const uint32_t patternColors[NUM_LEDS] = { PIXEL_RGBW(255, 0, 0, 0), PIXEL_RGBW(0, 255, 0, 0), PIXEL_RGBW(0, 0, 255, 0), PIXEL_RGBW(0, 0, 0, 255) };
+const uint32_t patternBrightness[NUM_LEDS] = { PIXEL_RGBW(63, 0, 0, 0), PIXEL_RGBW(128, 0, 0, 0), PIXEL_RGBW(191, 0, 0, 0), PIXEL_RGBW(255, 0, 0, 0) };
+const uint32_t patternRed1[NUM_LEDS] = { PIXEL_RGBW(255, 0, 0, 0), 0, 0, 0 };
+const uint32_t patternRed2[NUM_LEDS] = { PIXEL_RGBW(255, 0, 0, 0), PIXEL_RGBW(255, 0, 0, 0), 0, 0 };
+const uint32_t patternRed3[NUM_LEDS] = { PIXEL_RGBW(255, 0, 0, 0), PIXEL_RGBW(255, 0, 0, 0), PIXEL_RGBW(255, 0, 0, 0), 0 };
+
+// turns a pixel command into an effect and starts it, replacing the one running
+int pixelCommand(int command, uint16_t cause)
+{
+  PixelEffect fx = { PIXEL_SOLID, PIXEL_FRAME_HZ, 0, 0, NULL };
+  switch(command)
+  {
+    case 0: // display all red
+      fx.color = PIXEL_RGBW(255, 0, 0, 0);
       break;
-    case 1:
-      printNum1on();
-      printNum1off();
+    case 1: // display all green
+      fx.color = PIXEL_RGBW(0, 255, 0, 0);
       break;
-    case 2:
-      printNum2on();
-      printNum2off();
+    case 2: // display all blue
+      fx.color = PIXEL_RGBW(0, 0, 255, 0);
       break;
-    case 3:
-      printNum3on();
-      printNum3off();
+    case 3: // display all white
+      fx.color = PIXEL_RGBW(0, 0, 0, 255);
       break;
-    case 4:
-      printNum4on();
-      printNum4off();
+    case 4: // display pix 0 -> red, pix1 -> green, pix2 -> blue, pix3 -> white
+      fx.type = PIXEL_PATTERN;
+      fx.pattern = patternColors;
       break;
-    case 5:
-      printNum5on();
-      printNum5off();
+    case 5: // display individual pixel brightness
+      fx.type = PIXEL_PATTERN;
+      fx.pattern = patternBrightness;
       break;
-    case 6:
-      printNum6on();
-      printNum6off();
+    case 6: // display rainbow affect
+      fx.type = PIXEL_RAINBOW;
       break;
     case 7:
-      printNum7on();
-      printNum7off();
+      fx.type = PIXEL_PATTERN;
+      fx.pattern = patternRed1;
       break;
     case 8:
-      printNum8on();
-      printNum8off();
+      fx.type = PIXEL_PATTERN;
+      fx.pattern = patternRed2;
       break;
     case 9:
-      printNum9on();
-      printNum9off();
-      break;
-    case 10:          // A
-      printNumAon();
-      printNumAoff();
-      break;
-    case 11:          // B
-      printNumBon();
-      printNumBoff();
-      break;
-    case 12:          // C
-      printNumCon();
-      printNumCoff();
-      break;
-    case 13:          // D
-      printNumDon();
-      printNumDoff();
-      break;
-    case 14:          // E
-      printNumEon();
-      printNumEoff();
+      fx.type = PIXEL_PATTERN;
+      fx.pattern = patternRed3;
       break;
-    case 15:          // F
-      printNumFon();
-      printNumFoff();
+    case 10: // blank
+      fx.color = 0;
       break;
-    case 16:          // L
-      printNumLon();
-      printNumLoff();
-      break;
-    case 17:          // R
-      printNumRon();
-      printNumRoff();
-      break;
-    case 18:          // dp
-      printDPon();
-      printDPoff();
-      break;
-    case 19:
-      printDashon();
-      printDashoff();
+    case 11:
+      fx.type = PIXEL_PULSE;
       break;
+    case PIXEL_CMD_STOP:
+      pixelStop();
+      return 0;
+    default:
+      return 1;
   }
+  pixelStart(&fx, cause); // vPixelCommands steps it from here
+  return 0;
 }
 
-// function to print digits to seven seg display
-void printSevSeg(int side, int off, int num)
+uint8_t red(uint32_t c)
 {
-  digitalWrite(off, HIGH);
-  digitalWrite(side, LOW);
-  sevSegNumbers(num);
-  vTaskDelay(FRAME_RATE);
-  sevSegNumbers(num);
+  return (c >> 16);
+}
+
+uint8_t green(uint32_t c)
+{
+  return (c >> 8);
 }
 
-// function manages 7 seg Display
-void segManager(int lNum, int rNum)
+uint8_t blue(uint32_t c)
 {
-  xQueueSend(leftDigQueue, &lNum, portMAX_DELAY);
-  xQueueSend(rightDigQueue, &rNum, portMAX_DELAY);
+  return (c);
 }
 
-// function checks if queue is full
-void checkQueueIsFull(int test)
+// sends one whole move to the stepper task and waits for the driver to notify
+// this task that it finished. if mode isn't -1 the move is aborted once
+// modeIndex() leaves that mode. returns false if the move was aborted
+bool stepperSend(MotionCommand cmd, int mode)
 {
-  int lDig = 0;
-  int rDig = 0;
-  if(test == 0) // resets if test is 0
+  uint32_t events = 0;
+  uint32_t pending = 0; // input events that came in while waiting, vDipSwitch still wants them
+  bool finished = true;
+  cmd.notify = xTaskGetCurrentTaskHandle();
+  cmd.cause = latencyCommand();
+  xQueueSend(stepperQueue, &cmd, portMAX_DELAY);
+  for(;;)
   {
-    for(int i = 0; i == 255; i++)
+    events = 0;
+    xTaskNotifyWait(0, STEPPER_EVT_DONE, &events, 50 / portTICK_PERIOD_MS);
+    pending |= events & ~STEPPER_EVT_DONE;
+    if(events & STEPPER_EVT_DONE)
+    {
+      break;
+    }
+    if(finished && mode != -1 && modeIndex() != mode)
     {
-      lDig = i / 16;
-      rDig = i % 16;
-      segManager(lDig,rDig);
+      stepperAbort(); // then keep waiting, the ramp down ends with STEPPER_EVT_DONE too
+      finished = false;
     }
-    for(int i = 0; i < 10; i++) // if full, display OF
+  }
+  if(pending != 0)
+  {
+    xTaskNotify(cmd.notify, 0, eNoAction); // the bits are still set, this just makes them pending again
+  }
+  return finished;
+}
+
+// moves the stepper steps steps in direction
+bool stepperMove(int8_t direction, uint16_t steps, int mode)
+{
+  MotionCommand cmd = { direction, steps, false, STEPPER_RPM, false, NULL, 0 };
+  return stepperSend(cmd, mode);
+}
+
+// moves the stepper to an absolute position
+bool stepperMoveToPosition(uint16_t target, int mode)
+{
+  MotionCommand cmd = { 0, target, true, STEPPER_RPM, false, NULL, 0 };
+  return stepperSend(cmd, mode);
+}
+
+// stops the move the stepper task is running
+void stepperAbort()
+{
+  MotionCommand cmd = { 0, 0, false, 0, true, NULL, 0 };
+  xQueueSend(stepperQueue, &cmd, portMAX_DELAY);
+}
+
+// turns a gauge reading in hundredths into a stepper position, clamped to half a turn
+uint16_t gaugePosition(int16_t value, int stepsPerUnit)
+{
+  int32_t steps = ((int32_t) value * stepsPerUnit + 50) / 100;
+  if(steps < 0)
+  {
+    steps = 0;
+  }
+  if(steps > STEPPER_STEPS_PER_REV / 2)
+  {
+    steps = STEPPER_STEPS_PER_REV / 2;
+  }
+  return steps;
+}
+
+// true if any of a gauge's triggers fire for stats
+bool gaugeTriggered(const RingTrigger *triggers, const RingStats *stats, int stepsPerUnit)
+{
+  int16_t shown = (int32_t) stepperPosition() * 100 / stepsPerUnit; // the reading the gauge points at
+  for(uint8_t i = 0; i < GAUGE_TRIGGERS; i++)
+  {
+    if(ringTriggered(&triggers[i], stats, shown))
     {
-      segManager(0, 15);
+      return true;
     }
   }
-  if(xQueueIsQueueFullFromISR(leftDigQueue) == pdTRUE) // if function is full from ISR, reset queues
+  return false;
+}
+
+/****************************************************
+ * void vBenchmark(void *pvParameters)
+ *
+ *  Benchmark build only. Times each output path with
+ *  the display interrupt still running, so the numbers
+ *  include what it steals, then prints one BENCH line
+ *  per path and idles.
+ * *************************************************/
+void vBenchmark(void *pvParameters)
+{
+  (void) pvParameters;
+  benchBegin();
+
+  benchReset("setDigits");
+  for(uint8_t i = 0; i < BENCH_SAMPLES; i++)
+  {
+    BENCH_CALL(setDigits(i & 0x0F, (i >> 4) & 0x0F));
+  }
+  benchReport(1);
+
+  benchReset("sevSegRefreshIsr");
+  for(uint8_t i = 0; i < BENCH_SAMPLES; i++)
+  {
+    BENCH_CALL(sevSegRefreshIsr());
+  }
+  benchReport(1);
+
+  // what vSensor does with each reading once it is off the bus, conversion and both windows
+  static SampleRing benchTempRing;
+  static SampleRing benchHumRing;
+  RingStats benchStats;
+  ringReset(&benchTempRing);
+  ringReset(&benchHumRing);
+  benchReset("sensorSample");
+  for(uint8_t i = 0; i < BENCH_SAMPLES; i++)
   {
-    xQueueReset(leftDigQueue);
-    xQueueReset(rightDigQueue);
-    xSemaphoreGive(xBinarySemaphore);
-    segManager(0,15);
-    vTaskDelay((1000 / portTICK_PERIOD_MS) * 5);
-    xSemaphoreTake(xBinarySemaphore, portMAX_DELAY);
+    uint16_t raw = 0x6000 + ((uint16_t) i << 4);
+    BENCH_CALL(ringPush(&benchTempRing, sensorTempCenti(raw)); ringPush(&benchHumRing, sensorHumCenti(raw));
+               ringStats(&benchTempRing, &benchStats, SENSOR_SAMPLES_PER_MIN); ringStats(&benchHumRing, &benchStats, SENSOR_SAMPLES_PER_MIN));
   }
-  else
+  benchReport(1);
+
+  // commands 0 - 5 each differ from the one before, so every call reaches show()
+  benchReset("pixelCommand");
+  for(uint8_t i = 0; i < BENCH_SAMPLES; i++)
   {
-    xSemaphoreGive(xBinarySemaphore);
-    vTaskDelay((1000 / portTICK_PERIOD_MS) * 5);
-    xSemaphoreTake(xBinarySemaphore, portMAX_DELAY);
+    BENCH_CALL(pixelCommand(i % 6, 0); pixelStep());
   }
-}
\ No newline at end of file
+  benchReport(1);
+
+  // the full 256 frame rainbow with no wait between frames, per_s is frames a second
+  PixelEffect rainbow = { PIXEL_RAINBOW, 0, 0, 0, NULL };
+  benchReset("rainbowCycle");
+  for(uint8_t i = 0; i < 4; i++)
+  {
+    BENCH_CALL(pixelPlay(&rainbow));
+  }
+  benchReport(256);
+
+  // one revolution at the normal cruise speed, per_s is steps a second
+  benchReset("stepperRev");
+  for(uint8_t i = 0; i < 3; i++)
+  {
+    BENCH_CALL(stepperStart(1, STEPPER_STEPS_PER_REV, STEPPER_RPM_TO_SPS(STEPPER_RPM), xTaskGetCurrentTaskHandle(), 0);
+               xTaskNotifyWait(0, STEPPER_EVT_DONE, NULL, portMAX_DELAY));
+  }
+  benchReport(STEPPER_STEPS_PER_REV);
+
+  // where the time went while the suite ran, and how much stack it needed
+  runStatsSample();
+  RunStatsTask stats;
+  for(uint8_t i = 0; i < runStatsCount(); i++)
+  {
+    runStatsGet(i, &stats);
+    Serial.print("BENCH,task,");
+    Serial.print(stats.name);
+    Serial.print(',');
+    Serial.print(stats.cpu / 10.0, 1);
+    Serial.print(',');
+    Serial.println(stats.stackFree);
+  }
+  Serial.print("BENCH,idle,");
+  Serial.println(runStatsIdle() / 10.0, 1);
+  Serial.print("BENCH,asleep,");
+  Serial.println(runStatsAsleep() / 10.0, 1);
+  Serial.println("BENCH,done");
+  for(;;)
+  {
+    vTaskDelay(portMAX_DELAY);
+  }
+}
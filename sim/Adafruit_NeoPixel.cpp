@@ -0,0 +1,60 @@
+#include "Adafruit_NeoPixel.h"
+
+static unsigned long simShows = 0;
+
+unsigned long simPixelShows()
+{
+    return simShows;
+}
+
+Adafruit_NeoPixel::Adafruit_NeoPixel(uint16_t n, uint16_t p, neoPixelType type)
+{
+    (void) type;
+    count = n;
+    pin = p;
+    brightness = 0;
+    pixels = new uint32_t[n]();
+}
+
+Adafruit_NeoPixel::~Adafruit_NeoPixel()
+{
+    delete[] pixels;
+}
+
+void Adafruit_NeoPixel::show()
+{
+    simShows++;
+    simTrace("show", pin, count);
+    delayMicroseconds(SIM_NEOPIXEL_US_PER_PIXEL * count); // interrupts are off for the whole write
+}
+
+void Adafruit_NeoPixel::clear()
+{
+    for(uint16_t i = 0; i < count; i++)
+    {
+        pixels[i] = 0;
+    }
+}
+
+void Adafruit_NeoPixel::setPixelColor(uint16_t n, uint32_t c)
+{
+    if(n < count)
+    {
+        pixels[n] = c;
+    }
+}
+
+void Adafruit_NeoPixel::setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b)
+{
+    setPixelColor(n, Color(r, g, b));
+}
+
+void Adafruit_NeoPixel::setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b, uint8_t w)
+{
+    setPixelColor(n, Color(r, g, b, w));
+}
+
+uint32_t Adafruit_NeoPixel::getPixelColor(uint16_t n) const
+{
+    return n < count ? pixels[n] : 0;
+}
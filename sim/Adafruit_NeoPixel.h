@@ -0,0 +1,54 @@
+#ifndef SIM_ADAFRUIT_NEOPIXEL
+#define SIM_ADAFRUIT_NEOPIXEL
+
+// Host stand-in for Adafruit_NeoPixel. show() holds the CPU for the
+// 30 us per pixel the real bit-banged write takes with interrupts off,
+// counts the frame and traces it as "show,<pin>,<pixels>".
+
+#include <Arduino.h>
+
+#define NEO_GRB  0x52
+#define NEO_GRBW 0xD2
+#define NEO_KHZ800 0x0000
+
+#define SIM_NEOPIXEL_US_PER_PIXEL 30
+
+typedef uint16_t neoPixelType;
+
+class Adafruit_NeoPixel
+{
+  public:
+    Adafruit_NeoPixel(uint16_t n, uint16_t pin, neoPixelType type);
+    ~Adafruit_NeoPixel();
+    void begin() {}
+    void show();
+    bool canShow() { return true; }
+    void clear();
+    void setPixelColor(uint16_t n, uint32_t c);
+    void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b);
+    void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b, uint8_t w);
+    uint32_t getPixelColor(uint16_t n) const;
+    void setBrightness(uint8_t b) { brightness = b; }
+    uint8_t getBrightness() const { return brightness; }
+    uint16_t numPixels() const { return count; }
+    static uint32_t Color(uint8_t r, uint8_t g, uint8_t b)
+    {
+        return ((uint32_t) r << 16) | ((uint32_t) g << 8) | b;
+    }
+    static uint32_t Color(uint8_t r, uint8_t g, uint8_t b, uint8_t w)
+    {
+        return ((uint32_t) w << 24) | ((uint32_t) r << 16) | ((uint32_t) g << 8) | b;
+    }
+
+  private:
+    uint16_t count;
+    uint16_t pin;
+    uint8_t brightness;
+    uint32_t *pixels;
+};
+
+// sim side, show() calls across every strip
+unsigned long simPixelShows();
+
+
+#endif
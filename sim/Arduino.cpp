@@ -0,0 +1,270 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <deque>
+#include <thread>
+#include "SimCore.h"
+
+HardwareSerial Serial;
+
+static uint8_t simLevel[SIM_PINS];
+static uint8_t simMode[SIM_PINS];
+static unsigned long simWrites[SIM_PINS];
+static unsigned long simRises[SIM_PINS];
+static unsigned long simFalls[SIM_PINS];
+static FILE *simTraceFile = NULL;
+static bool simTraceOpened = false;
+
+/*********************************************************
+ * void simTrace(const char *event, int id, long value)
+ *
+ * Appends "micros,event,id,value" to the SIM_TRACE file,
+ * e.g. "1520,pin,44,0" for D44 going low or
+ * "2210,show,24,4" for a 4 pixel strip.show() on D24.
+ * *******************************************************/
+void simTrace(const char *event, int id, long value)
+{
+    if(!simTraceOpened)
+    {
+        simTraceOpened = true;
+        const char *path = getenv("SIM_TRACE");
+        if(path != NULL)
+        {
+            simTraceFile = fopen(path, "w");
+        }
+    }
+    if(simTraceFile != NULL)
+    {
+        fprintf(simTraceFile, "%lu,%s,%d,%ld\n", micros(), event, id, value);
+    }
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    if(pin < SIM_PINS)
+    {
+        simMode[pin] = mode;
+    }
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+    if(pin >= SIM_PINS)
+    {
+        return;
+    }
+    val = val ? HIGH : LOW;
+    simWrites[pin]++;
+    if(val != simLevel[pin])
+    {
+        if(val == HIGH)
+        {
+            simRises[pin]++;
+        }
+        else
+        {
+            simFalls[pin]++;
+        }
+        simLevel[pin] = val;
+        simTrace("pin", pin, val);
+    }
+}
+
+int digitalRead(uint8_t pin)
+{
+    return pin < SIM_PINS ? simLevel[pin] : LOW;
+}
+
+void simSetInput(uint8_t pin, uint8_t val)
+{
+    if(pin < SIM_PINS)
+    {
+        simLevel[pin] = val ? HIGH : LOW;
+        simTrace("input", pin, simLevel[pin]);
+    }
+}
+
+unsigned long simPinWrites(uint8_t pin)
+{
+    return pin < SIM_PINS ? simWrites[pin] : 0;
+}
+
+unsigned long simPinRises(uint8_t pin)
+{
+    return pin < SIM_PINS ? simRises[pin] : 0;
+}
+
+unsigned long simPinFalls(uint8_t pin)
+{
+    return pin < SIM_PINS ? simFalls[pin] : 0;
+}
+
+unsigned long micros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(SimClock::now() - simStart).count();
+}
+
+unsigned long millis()
+{
+    return micros() / 1000;
+}
+
+// busy waits keep the CPU, so the lock is held through them
+void delay(unsigned long ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void noInterrupts()
+{
+}
+
+void interrupts()
+{
+}
+
+/*********************************************************
+ * Serial goes to stdout and comes from stdin. A thread
+ * blocks on stdin so the firmware's polling never does,
+ * and has its own lock so it never holds up the sim.
+ * Like the real UART only 64 bytes are buffered, the
+ * rest is dropped.
+ * *******************************************************/
+static std::mutex simRxLock;
+static std::deque<uint8_t> simRx;
+
+static void simRxThread()
+{
+    int c;
+    while((c = getchar()) != EOF)
+    {
+        std::lock_guard<std::mutex> held(simRxLock);
+        if(simRx.size() < 64)
+        {
+            simRx.push_back(c);
+        }
+    }
+}
+
+void HardwareSerial::begin(unsigned long baud)
+{
+    (void) baud;
+    std::thread(simRxThread).detach();
+}
+
+int HardwareSerial::available()
+{
+    std::lock_guard<std::mutex> held(simRxLock);
+    return simRx.size();
+}
+
+int HardwareSerial::read()
+{
+    std::lock_guard<std::mutex> held(simRxLock);
+    if(simRx.empty())
+    {
+        return -1;
+    }
+    int c = simRx.front();
+    simRx.pop_front();
+    return c;
+}
+
+int HardwareSerial::availableForWrite()
+{
+    return 63;
+}
+
+void HardwareSerial::flush()
+{
+    fflush(stdout);
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+    return fwrite(&c, 1, 1, stdout);
+}
+
+size_t HardwareSerial::write(const uint8_t *buf, size_t len)
+{
+    return fwrite(buf, 1, len, stdout);
+}
+
+size_t HardwareSerial::print(const char *s)
+{
+    return fputs(s, stdout) >= 0 ? strlen(s) : 0;
+}
+
+size_t HardwareSerial::print(char c)
+{
+    return write((uint8_t) c);
+}
+
+size_t HardwareSerial::print(int n, int base)
+{
+    return print((long) n, base);
+}
+
+size_t HardwareSerial::print(unsigned int n, int base)
+{
+    return print((unsigned long) n, base);
+}
+
+size_t HardwareSerial::print(long n, int base)
+{
+    return printf(base == HEX ? "%lX" : "%ld", n);
+}
+
+size_t HardwareSerial::print(unsigned long n, int base)
+{
+    return printf(base == HEX ? "%lX" : "%lu", n);
+}
+
+size_t HardwareSerial::print(double n, int digits)
+{
+    return printf("%.*f", digits, n);
+}
+
+size_t HardwareSerial::println()
+{
+    return print("\r\n");
+}
+
+size_t HardwareSerial::println(const char *s)
+{
+    return print(s) + println();
+}
+
+size_t HardwareSerial::println(char c)
+{
+    return print(c) + println();
+}
+
+size_t HardwareSerial::println(int n, int base)
+{
+    return print(n, base) + println();
+}
+
+size_t HardwareSerial::println(unsigned int n, int base)
+{
+    return print(n, base) + println();
+}
+
+size_t HardwareSerial::println(long n, int base)
+{
+    return print(n, base) + println();
+}
+
+size_t HardwareSerial::println(unsigned long n, int base)
+{
+    return print(n, base) + println();
+}
+
+size_t HardwareSerial::println(double n, int digits)
+{
+    return print(n, digits) + println();
+}
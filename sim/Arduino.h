@@ -0,0 +1,87 @@
+#ifndef SIM_ARDUINO
+#define SIM_ARDUINO
+
+// Host stand-in for the Arduino core. Pins are plain arrays, every
+// output transition is counted and optionally logged with a micros()
+// timestamp to the file named by SIM_TRACE.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+
+#ifndef F_CPU
+  #define F_CPU 16000000UL
+#endif
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#define DEC 10
+#define HEX 16
+
+#define F(s) (s)
+
+#define SIM_PINS 70
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+unsigned long micros();
+unsigned long millis();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void noInterrupts();
+void interrupts();
+
+class HardwareSerial
+{
+  public:
+    void begin(unsigned long baud);
+    operator bool() { return true; }
+    int available();
+    int read();
+    int availableForWrite();
+    void flush();
+    size_t write(uint8_t c);
+    size_t write(const uint8_t *buf, size_t len);
+    size_t print(const char *s);
+    size_t print(char c);
+    size_t print(int n, int base = DEC);
+    size_t print(unsigned int n, int base = DEC);
+    size_t print(long n, int base = DEC);
+    size_t print(unsigned long n, int base = DEC);
+    size_t print(double n, int digits = 2);
+    size_t println();
+    size_t println(const char *s);
+    size_t println(char c);
+    size_t println(int n, int base = DEC);
+    size_t println(unsigned int n, int base = DEC);
+    size_t println(long n, int base = DEC);
+    size_t println(unsigned long n, int base = DEC);
+    size_t println(double n, int digits = 2);
+};
+
+extern HardwareSerial Serial;
+
+// sim side, used by the harness
+void simTrace(const char *event, int id, long value);
+void simSetInput(uint8_t pin, uint8_t val);
+unsigned long simPinWrites(uint8_t pin);   // digitalWrite calls on pin
+unsigned long simPinRises(uint8_t pin);    // LOW to HIGH transitions
+unsigned long simPinFalls(uint8_t pin);    // HIGH to LOW transitions
+
+void setup();
+void loop();
+
+
+#endif
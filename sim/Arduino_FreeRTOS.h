@@ -0,0 +1,121 @@
+#ifndef SIM_ARDUINO_FREERTOS
+#define SIM_ARDUINO_FREERTOS
+
+// Host stand-in for the FreeRTOS API the firmware uses. Every task is a
+// thread, but only the holder of one big lock runs, so the firmware sees
+// a single core: a task keeps the CPU until it blocks, yields or an
+// emulated interrupt takes the lock. Priorities are recorded but not
+// used for scheduling. Ticks follow the wall clock at the 16 ms watchdog
+// tick the Mega port uses.
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint32_t TickType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint8_t StackType_t;
+typedef uint32_t EventBits_t;
+typedef void (*TaskFunction_t)(void *);
+
+typedef struct SimTask *TaskHandle_t;
+typedef struct SimQueue *QueueHandle_t;
+typedef QueueHandle_t SemaphoreHandle_t;
+
+// the firmware allocates everything statically like the Mega build, the
+// sim takes the buffers and ignores them
+#define configSUPPORT_STATIC_ALLOCATION 1
+#define configSUPPORT_DYNAMIC_ALLOCATION 1
+#define configMINIMAL_STACK_SIZE 192
+typedef struct { uint8_t unused; } StaticTask_t;
+typedef struct { uint8_t unused; } StaticQueue_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdFAIL 0
+#define pdPASS 1
+#define errQUEUE_FULL 0
+#define errQUEUE_EMPTY 0
+
+#define portMAX_DELAY ((TickType_t) 0xFFFFFFFFUL)
+#define portTICK_PERIOD_MS ((TickType_t) 16)
+#define configTICK_RATE_HZ ((TickType_t) (1000 / 16))
+#define pdMS_TO_TICKS(ms) ((TickType_t) ((ms) / portTICK_PERIOD_MS))
+
+// kernel trace hooks, SimRTOS.cpp calls them where the real kernel does.
+// RtosConfig.h defines the ones the firmware uses
+#ifndef traceTASK_SWITCHED_IN
+#define traceTASK_SWITCHED_IN()
+#endif
+#ifndef traceTASK_SWITCHED_OUT
+#define traceTASK_SWITCHED_OUT()
+#endif
+#ifndef traceTASK_INCREMENT_TICK
+#define traceTASK_INCREMENT_TICK(count)
+#endif
+#ifndef traceQUEUE_SEND
+#define traceQUEUE_SEND(queue)
+#endif
+#ifndef traceQUEUE_SEND_FROM_ISR
+#define traceQUEUE_SEND_FROM_ISR(queue)
+#endif
+#ifndef traceQUEUE_RECEIVE
+#define traceQUEUE_RECEIVE(queue)
+#endif
+#ifndef traceQUEUE_RECEIVE_FROM_ISR
+#define traceQUEUE_RECEIVE_FROM_ISR(queue)
+#endif
+#ifndef traceBLOCKING_ON_QUEUE_SEND
+#define traceBLOCKING_ON_QUEUE_SEND(queue)
+#endif
+#ifndef traceBLOCKING_ON_QUEUE_RECEIVE
+#define traceBLOCKING_ON_QUEUE_RECEIVE(queue)
+#endif
+#ifndef traceQUEUE_SEND_FAILED
+#define traceQUEUE_SEND_FAILED(queue)
+#endif
+#ifndef traceQUEUE_RECEIVE_FAILED
+#define traceQUEUE_RECEIVE_FAILED(queue)
+#endif
+#ifndef traceTASK_NOTIFY
+#define traceTASK_NOTIFY(...)
+#endif
+#ifndef traceTASK_NOTIFY_FROM_ISR
+#define traceTASK_NOTIFY_FROM_ISR(...)
+#endif
+
+#define taskENTER_CRITICAL()
+#define taskEXIT_CRITICAL()
+#define taskYIELD() simYield()
+#define portYIELD_FROM_ISR() // the woken task runs once the emulated interrupt lets go of the lock
+
+typedef enum
+{
+    eNoAction = 0,
+    eSetBits,
+    eIncrement,
+    eSetValueWithOverwrite,
+    eSetValueWithoutOverwrite
+} eNotifyAction;
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t fn, const char *name, uint32_t stackDepth, void *param, UBaseType_t priority, StackType_t *stack, StaticTask_t *tcb);
+void vApplicationGetIdleTaskMemory(StaticTask_t **tcb, StackType_t **stack, uint32_t *stackDepth);
+void vTaskStartScheduler();
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t *previousWake, TickType_t increment);
+TickType_t xTaskGetTickCount();
+TickType_t xTaskGetTickCountFromISR();
+TaskHandle_t xTaskGetCurrentTaskHandle();
+const char *pcTaskGetName(TaskHandle_t task);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action);
+BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action, BaseType_t *woken);
+BaseType_t xTaskNotifyWait(uint32_t clearOnEntry, uint32_t clearOnExit, uint32_t *value, TickType_t timeout);
+
+// sim side
+void simYield();
+void simRunFor(unsigned long ms); // how long vTaskStartScheduler runs before the report
+
+
+#endif
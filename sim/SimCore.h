@@ -0,0 +1,39 @@
+#ifndef SIM_CORE
+#define SIM_CORE
+
+// Shared plumbing for the sim: the big lock that makes the host look
+// like one core, the condition variable every blocked task waits on and
+// the clock everything is timed against.
+
+#include <stdint.h>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
+typedef std::chrono::steady_clock SimClock;
+
+extern std::recursive_mutex simLock;
+extern std::condition_variable_any simWake;
+extern SimClock::time_point simStart;
+
+// the lock this thread holds while it runs firmware code
+extern thread_local std::unique_lock<std::recursive_mutex> *simHeld;
+
+// blocks the calling task until ready() or deadline, giving the CPU away meanwhile.
+// returns ready()
+bool simWaitUntil(SimClock::time_point deadline, const std::function<bool()> &ready);
+
+// wakes every blocked task so it can recheck what it waits on
+void simNotify();
+
+// ticks to a deadline, portMAX_DELAY waits forever
+SimClock::time_point simDeadline(uint32_t ticks);
+
+// the emulated timers and scripted inputs run on their own thread
+void simTimersBegin();
+void simTimersStop();
+void simScheduleInput(unsigned long ms, uint8_t pin, uint8_t level);
+
+
+#endif
@@ -0,0 +1,125 @@
+#include <Arduino.h>
+#include <Arduino_FreeRTOS.h>
+#include <stdio.h>
+#include "SimCore.h"
+#include "Adafruit_NeoPixel.h"
+#include "Wire.h"
+#include "../SevSegNum.h"
+#include "../StepperDriver.h"
+#include "../Inputs.h"
+#include "../Latency.h"
+#include "../PixelEngine.h"
+
+static unsigned long simRunMs = 10000;
+
+static double simEnv(const char *name, double fallback)
+{
+    const char *value = getenv(name);
+    return value != NULL ? atof(value) : fallback;
+}
+
+/*********************************************************
+ * static void simLoadScript(const char *path)
+ *
+ * Reads "ms pin level" lines, e.g. "2000 29 1" presses
+ * button 3 two seconds in. Blank lines and lines starting
+ * with # are skipped.
+ * *******************************************************/
+static void simLoadScript(const char *path)
+{
+    FILE *script = fopen(path, "r");
+    if(script == NULL)
+    {
+        fprintf(stderr, "SIM can't open script %s\n", path);
+        exit(1);
+    }
+    char line[128];
+    while(fgets(line, sizeof line, script) != NULL)
+    {
+        unsigned long ms;
+        unsigned int pin, level;
+        if(line[0] != '#' && sscanf(line, "%lu %u %u", &ms, &pin, &level) == 3)
+        {
+            simScheduleInput(ms, pin, level);
+        }
+    }
+    fclose(script);
+}
+
+/*********************************************************
+ * void simReport()
+ *
+ * Called by vTaskStartScheduler() once the run is over.
+ * Prints one "SIM key=value" line per metric to stderr so
+ * it stays apart from the firmware's serial output.
+ * *******************************************************/
+void simReport()
+{
+    double seconds = micros() / 1000000.0;
+    fprintf(stderr, "SIM run_s=%.3f\n", seconds);
+    // each refresh lights the left digit once
+    fprintf(stderr, "SIM display_refresh_hz=%.1f\n", simPinFalls(SevenSegCC2) / seconds);
+    // each step rewrites all four coils, IN1 included
+    fprintf(stderr, "SIM stepper_steps_per_s=%.1f\n", simPinWrites(STEPPER_IN1) / seconds);
+    fprintf(stderr, "SIM stepper_position=%u\n", stepperPosition());
+    fprintf(stderr, "SIM pixel_frames_per_s=%.1f\n", simPixelShows() / seconds);
+    // since the last stats frame, the telemetry task reads them too
+    FramePacerStats pacing;
+    pixelPacing(&pacing);
+    fprintf(stderr, "SIM pixel_frames=%u pixel_overruns=%u pixel_dropped=%u pixel_jitter_mean_us=%u pixel_jitter_max_us=%lu\n",
+            pacing.frames, pacing.overruns, pacing.dropped, pacing.jitterMean, (unsigned long) pacing.jitterMax);
+    // percentiles are bucket tops, 0 means past the last one
+    for(uint8_t mode = 0; mode < LATENCY_MODES; mode++)
+    {
+        LatencyHistogram histogram;
+        latencyGet(mode, &histogram);
+        uint16_t count = latencyCount(&histogram);
+        if(count > 0 || histogram.missed > 0 || histogram.ignored > 0)
+        {
+            fprintf(stderr, "SIM latency_mode=%u samples=%u missed=%u ignored=%u p50_us<%lu p90_us<%lu max_us=%lu\n", mode, count,
+                    histogram.missed, histogram.ignored,
+                    (unsigned long) latencyPercentile(&histogram, 50), (unsigned long) latencyPercentile(&histogram, 90),
+                    (unsigned long) histogram.max);
+        }
+    }
+}
+
+/*********************************************************
+ * int main()
+ *
+ * Environment:
+ *   SIM_SECONDS  how long to run, 10 by default
+ *   SIM_DIPS     DIP1 to DIP8 as 0s and 1s, all off by default
+ *   SIM_TEMP     sensor temperature in C
+ *   SIM_HUM      sensor humidity in %RH
+ *   SIM_SCRIPT   file of timed input changes
+ *   SIM_TRACE    file to log pin changes and strip writes to
+ * *******************************************************/
+int main()
+{
+    simRunMs = (unsigned long) (simEnv("SIM_SECONDS", 10.0) * 1000.0);
+    simRunFor(simRunMs);
+    simSetClimate(simEnv("SIM_TEMP", 22.5), simEnv("SIM_HUM", 45.0));
+
+    static const uint8_t dipPins[8] = { DIP1, DIP2, DIP3, DIP4, DIP5, DIP6, DIP7, DIP8 };
+    const char *dips = getenv("SIM_DIPS");
+    for(uint8_t i = 0; dips != NULL && i < 8 && dips[i] != '\0'; i++)
+    {
+        simSetInput(dipPins[i], dips[i] == '1' ? HIGH : LOW);
+    }
+
+    const char *script = getenv("SIM_SCRIPT");
+    if(script != NULL)
+    {
+        simLoadScript(script);
+    }
+
+    // setup() runs as if it were the only thing on the CPU, then hands over to the scheduler
+    std::unique_lock<std::recursive_mutex> held(simLock);
+    simHeld = &held;
+    setup();
+    for(;;)
+    {
+        loop();
+    }
+}
@@ -0,0 +1,433 @@
+#include "../RtosConfig.h"
+#include <Arduino.h>
+#include <Arduino_FreeRTOS.h>
+#include <semphr.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <deque>
+#include <thread>
+#include <vector>
+#include "SimCore.h"
+
+std::recursive_mutex simLock;
+std::condition_variable_any simWake;
+SimClock::time_point simStart = SimClock::now();
+thread_local std::unique_lock<std::recursive_mutex> *simHeld = NULL;
+
+struct SimTask
+{
+    TaskFunction_t fn;
+    void *param;
+    const char *name;
+    uint16_t stackDepth;
+    UBaseType_t priority;
+    uint32_t notifyValue;
+    bool notifyPending;
+};
+
+struct SimQueue
+{
+    UBaseType_t length;
+    UBaseType_t itemSize;
+    std::deque<std::vector<uint8_t> > items;
+};
+
+static std::vector<SimTask *> simTasks;
+static thread_local SimTask *simCurrent = NULL;
+static unsigned long simRunMs = 10000;
+void simReport();
+
+// the trace hooks name the task pxCurrentTCB like the kernel does
+static void simSwitchedIn(SimTask *pxCurrentTCB)
+{
+    traceTASK_SWITCHED_IN();
+}
+
+static void simSwitchedOut(SimTask *pxCurrentTCB)
+{
+    traceTASK_SWITCHED_OUT();
+}
+
+bool simWaitUntil(SimClock::time_point deadline, const std::function<bool()> &ready)
+{
+    if(simHeld == NULL)
+    {
+        return ready(); // interrupt context never blocks
+    }
+    // the task is off the CPU while it waits, as far as the run time stats go
+    bool result = true;
+    simSwitchedOut(simCurrent);
+    if(deadline == SimClock::time_point::max())
+    {
+        simWake.wait(*simHeld, ready);
+    }
+    else
+    {
+        result = simWake.wait_until(*simHeld, deadline, ready);
+    }
+    simSwitchedIn(simCurrent);
+    return result;
+}
+
+void simNotify()
+{
+    simWake.notify_all();
+}
+
+SimClock::time_point simDeadline(uint32_t ticks)
+{
+    if(ticks == portMAX_DELAY)
+    {
+        return SimClock::time_point::max();
+    }
+    return SimClock::now() + std::chrono::milliseconds((unsigned long) ticks * portTICK_PERIOD_MS);
+}
+
+void simYield()
+{
+    if(simHeld != NULL)
+    {
+        simSwitchedOut(simCurrent);
+        simHeld->unlock();
+        std::this_thread::yield();
+        simHeld->lock();
+        simSwitchedIn(simCurrent);
+    }
+}
+
+void simRunFor(unsigned long ms)
+{
+    simRunMs = ms;
+}
+
+/*********************************************************
+ * tasks
+ * *******************************************************/
+TaskHandle_t xTaskCreateStatic(TaskFunction_t fn, const char *name, uint32_t stackDepth, void *param, UBaseType_t priority, StackType_t *stack, StaticTask_t *tcb)
+{
+    (void) stack;
+    (void) tcb;
+    SimTask *task = new SimTask();
+    task->fn = fn;
+    task->param = param;
+    task->name = name;
+    task->stackDepth = stackDepth;
+    task->priority = priority;
+    task->notifyValue = 0;
+    task->notifyPending = false;
+    simTasks.push_back(task);
+    return task;
+}
+
+static void simTaskMain(SimTask *task)
+{
+    std::unique_lock<std::recursive_mutex> held(simLock);
+    simHeld = &held;
+    simCurrent = task;
+    simSwitchedIn(task);
+    task->fn(task->param);
+}
+
+/*********************************************************
+ * void vTaskStartScheduler()
+ *
+ * Starts a thread per task and the timer thread, hands
+ * the lock over, then lets the firmware run for the time
+ * set by simRunFor() before printing the report and
+ * leaving without unwinding the task threads.
+ * *******************************************************/
+void vTaskStartScheduler()
+{
+    for(size_t i = 0; i < simTasks.size(); i++)
+    {
+        std::thread(simTaskMain, simTasks[i]).detach();
+    }
+    simTimersBegin();
+    if(simHeld != NULL)
+    {
+        simHeld->unlock();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(simRunMs));
+    simLock.lock();
+    simTimersStop();
+    simReport();
+    fflush(stdout);
+    fflush(stderr);
+    _exit(0);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    simWaitUntil(simDeadline(ticks), [] { return false; });
+}
+
+void vTaskDelayUntil(TickType_t *previousWake, TickType_t increment)
+{
+    TickType_t wake = *previousWake + increment;
+    SimClock::time_point deadline = simStart + std::chrono::milliseconds((unsigned long) wake * portTICK_PERIOD_MS);
+    simWaitUntil(deadline, [] { return false; });
+    *previousWake = wake;
+}
+
+TickType_t xTaskGetTickCount()
+{
+    return (TickType_t) (std::chrono::duration_cast<std::chrono::milliseconds>(SimClock::now() - simStart).count() / portTICK_PERIOD_MS);
+}
+
+TickType_t xTaskGetTickCountFromISR()
+{
+    return xTaskGetTickCount();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    return simCurrent;
+}
+
+const char *pcTaskGetName(TaskHandle_t task)
+{
+    if(task == NULL)
+    {
+        task = simCurrent;
+    }
+    return task != NULL ? task->name : "";
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+    (void) task;
+    return 0; // host stacks say nothing about the target's
+}
+
+/*********************************************************
+ * direct to task notifications
+ * *******************************************************/
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action)
+{
+    SimTask *pxTCB = task;
+    (void) pxTCB;
+    traceTASK_NOTIFY();
+    BaseType_t result = pdPASS;
+    switch(action)
+    {
+        case eSetBits:
+            task->notifyValue |= value;
+            break;
+        case eIncrement:
+            task->notifyValue++;
+            break;
+        case eSetValueWithOverwrite:
+            task->notifyValue = value;
+            break;
+        case eSetValueWithoutOverwrite:
+            if(task->notifyPending)
+            {
+                result = pdFAIL;
+            }
+            else
+            {
+                task->notifyValue = value;
+            }
+            break;
+        default:
+            break;
+    }
+    task->notifyPending = true;
+    simNotify();
+    return result;
+}
+
+BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action, BaseType_t *woken)
+{
+    if(woken != NULL)
+    {
+        *woken = pdTRUE;
+    }
+    return xTaskNotify(task, value, action);
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clearOnEntry, uint32_t clearOnExit, uint32_t *value, TickType_t timeout)
+{
+    SimTask *task = simCurrent;
+    if(!task->notifyPending)
+    {
+        task->notifyValue &= ~clearOnEntry;
+    }
+    bool received = simWaitUntil(simDeadline(timeout), [task] { return task->notifyPending; });
+    // the value goes out on a timeout too, as tasks.c does, with the entry bits cleared
+    if(value != NULL)
+    {
+        *value = task->notifyValue;
+    }
+    if(!received)
+    {
+        return pdFALSE;
+    }
+    task->notifyValue &= ~clearOnExit;
+    task->notifyPending = false;
+    return pdTRUE;
+}
+
+/*********************************************************
+ * queues and semaphores
+ * *******************************************************/
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+    SimQueue *queue = new SimQueue();
+    queue->length = length;
+    queue->itemSize = itemSize;
+    return queue;
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t itemSize, uint8_t *storage, StaticQueue_t *queue)
+{
+    (void) storage;
+    (void) queue;
+    return xQueueCreate(length, itemSize);
+}
+
+static BaseType_t simQueuePut(QueueHandle_t queue, const void *item, TickType_t timeout, bool front)
+{
+    if(queue->items.size() >= queue->length && timeout != 0)
+    {
+        traceBLOCKING_ON_QUEUE_SEND(queue);
+    }
+    if(!simWaitUntil(simDeadline(timeout), [queue] { return queue->items.size() < queue->length; }))
+    {
+        traceQUEUE_SEND_FAILED(queue);
+        return errQUEUE_FULL;
+    }
+    traceQUEUE_SEND(queue);
+    const uint8_t *bytes = (const uint8_t *) item;
+    std::vector<uint8_t> copy(bytes, bytes + (item != NULL ? queue->itemSize : 0));
+    if(front)
+    {
+        queue->items.push_front(copy);
+    }
+    else
+    {
+        queue->items.push_back(copy);
+    }
+    simNotify();
+    return pdPASS;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t timeout)
+{
+    return simQueuePut(queue, item, timeout, false);
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void *item, TickType_t timeout)
+{
+    return simQueuePut(queue, item, timeout, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void *item, TickType_t timeout)
+{
+    return simQueuePut(queue, item, timeout, true);
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *woken)
+{
+    if(woken != NULL)
+    {
+        *woken = pdTRUE;
+    }
+    return simQueuePut(queue, item, 0, false);
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void *item)
+{
+    queue->items.clear();
+    return simQueuePut(queue, item, 0, false);
+}
+
+static BaseType_t simQueueGet(QueueHandle_t queue, void *item, TickType_t timeout, bool remove)
+{
+    if(queue->items.empty() && timeout != 0)
+    {
+        traceBLOCKING_ON_QUEUE_RECEIVE(queue);
+    }
+    if(!simWaitUntil(simDeadline(timeout), [queue] { return !queue->items.empty(); }))
+    {
+        traceQUEUE_RECEIVE_FAILED(queue);
+        return errQUEUE_EMPTY;
+    }
+    if(remove)
+    {
+        traceQUEUE_RECEIVE(queue);
+    }
+    if(item != NULL && queue->itemSize > 0)
+    {
+        memcpy(item, queue->items.front().data(), queue->itemSize);
+    }
+    if(remove)
+    {
+        queue->items.pop_front();
+        simNotify();
+    }
+    return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t timeout)
+{
+    return simQueueGet(queue, item, timeout, true);
+}
+
+BaseType_t xQueueReceiveFromISR(QueueHandle_t queue, void *item, BaseType_t *woken)
+{
+    if(woken != NULL)
+    {
+        *woken = pdFALSE;
+    }
+    return simQueueGet(queue, item, 0, true);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void *item, TickType_t timeout)
+{
+    return simQueueGet(queue, item, timeout, false);
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue)
+{
+    queue->items.clear();
+    simNotify();
+    return pdPASS;
+}
+
+BaseType_t xQueueIsQueueFullFromISR(QueueHandle_t queue)
+{
+    return queue->items.size() >= queue->length ? pdTRUE : pdFALSE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    return queue->items.size();
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary()
+{
+    return xQueueCreate(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+    SemaphoreHandle_t sem = xQueueCreate(1, 0);
+    xSemaphoreGive(sem);
+    return sem;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    return simQueuePut(sem, NULL, 0, false);
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *woken)
+{
+    return xQueueSendFromISR(sem, NULL, woken);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t timeout)
+{
+    return simQueueGet(sem, NULL, timeout, true);
+}
@@ -0,0 +1,149 @@
+#include "../RtosConfig.h"
+#include <Arduino.h>
+#include <Arduino_FreeRTOS.h>
+#include <thread>
+#include <vector>
+#include "SimCore.h"
+
+volatile uint8_t SREG;
+volatile uint8_t TCCR3A, TCCR3B, TIMSK3, TIFR3;
+volatile uint8_t TCCR4A, TCCR4B, TIMSK4, TIFR4;
+volatile uint8_t TCCR5A, TCCR5B, TIMSK5, TIFR5;
+volatile uint16_t TCNT3, OCR3A, TCNT4, OCR4A, TCNT5, OCR5A;
+
+// vectors the firmware may or may not define
+extern "C" void TIMER3_COMPA_vect(void) __attribute__((weak));
+extern "C" void TIMER4_COMPA_vect(void) __attribute__((weak));
+extern "C" void TIMER5_COMPA_vect(void) __attribute__((weak));
+
+struct SimTimer
+{
+    volatile uint8_t *tccrb;
+    volatile uint8_t *timsk;
+    volatile uint16_t *ocr;
+    uint8_t ocie;
+    void (*vector)(void);
+    bool armed;
+    SimClock::time_point due;
+};
+
+struct SimInputEvent
+{
+    unsigned long ms;
+    uint8_t pin;
+    uint8_t level;
+};
+
+static SimTimer simTimers[3];
+static std::vector<SimInputEvent> simInputs;
+static size_t simNextInput = 0;
+static volatile bool simTimersRunning = false;
+static TickType_t simLastTick = 0;
+
+// CS bits 0 - 2 of TCCRnB pick the prescaler, 0 means the timer is stopped
+static unsigned long simPrescale(uint8_t tccrb)
+{
+    static const unsigned long prescale[8] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+    return prescale[tccrb & 0x07];
+}
+
+static SimClock::duration simPeriod(const SimTimer &t)
+{
+    unsigned long long ns = ((unsigned long long) *t.ocr + 1) * simPrescale(*t.tccrb) * 1000000000ULL / F_CPU;
+    return std::chrono::nanoseconds(ns);
+}
+
+// inputs from SIM_SCRIPT, in time order
+void simScheduleInput(unsigned long ms, uint8_t pin, uint8_t level)
+{
+    SimInputEvent ev = { ms, pin, level };
+    size_t i = simInputs.size();
+    simInputs.push_back(ev);
+    while(i > 0 && simInputs[i - 1].ms > ms)
+    {
+        simInputs[i] = simInputs[i - 1];
+        simInputs[i - 1] = ev;
+        i--;
+    }
+}
+
+/*********************************************************
+ * static void simTimerThread()
+ *
+ * Stands in for the timer hardware. Each pass it takes
+ * the lock, so an interrupt never runs in the middle of
+ * task code, fires every compare A vector that is due and
+ * applies scripted input changes. A timer that has just
+ * had its interrupt enabled starts a fresh period, like
+ * the TCNTn = 0 the firmware writes when it arms one.
+ * *******************************************************/
+static void simTimerThread()
+{
+    while(simTimersRunning)
+    {
+        SimClock::time_point next = SimClock::now() + std::chrono::milliseconds(1);
+        {
+            std::lock_guard<std::recursive_mutex> held(simLock);
+            SimClock::time_point now = SimClock::now();
+            unsigned long ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - simStart).count();
+            while(simNextInput < simInputs.size() && simInputs[simNextInput].ms <= ms)
+            {
+                simSetInput(simInputs[simNextInput].pin, simInputs[simNextInput].level);
+                simNextInput++;
+            }
+            // the watchdog tick, for the trace hook
+            TickType_t tick = xTaskGetTickCount();
+            while(simLastTick != tick)
+            {
+                simLastTick++;
+                traceTASK_INCREMENT_TICK(simLastTick);
+            }
+            for(int i = 0; i < 3; i++)
+            {
+                SimTimer &t = simTimers[i];
+                bool enabled = t.vector != NULL && (*t.timsk & _BV(t.ocie)) && simPrescale(*t.tccrb) != 0;
+                if(!enabled)
+                {
+                    t.armed = false;
+                    continue;
+                }
+                if(!t.armed)
+                {
+                    t.armed = true;
+                    t.due = now + simPeriod(t);
+                }
+                else if(now >= t.due)
+                {
+                    t.vector();
+                    t.due += simPeriod(t);
+                    if(t.due < now)
+                    {
+                        t.due = now + simPeriod(t); // host fell behind, don't fire a burst to catch up
+                    }
+                }
+                if(t.armed && t.due < next)
+                {
+                    next = t.due;
+                }
+            }
+        }
+        std::this_thread::sleep_until(next);
+    }
+}
+
+void simTimersBegin()
+{
+    SimTimer t3 = { &TCCR3B, &TIMSK3, &OCR3A, OCIE3A, TIMER3_COMPA_vect, false, SimClock::now() };
+    SimTimer t4 = { &TCCR4B, &TIMSK4, &OCR4A, OCIE4A, TIMER4_COMPA_vect, false, SimClock::now() };
+    SimTimer t5 = { &TCCR5B, &TIMSK5, &OCR5A, OCIE5A, TIMER5_COMPA_vect, false, SimClock::now() };
+    simTimers[0] = t3;
+    simTimers[1] = t4;
+    simTimers[2] = t5;
+    simTimersRunning = true;
+    std::thread(simTimerThread).detach();
+}
+
+void simTimersStop()
+{
+    simTimersRunning = false;
+}
@@ -0,0 +1,95 @@
+#include "Wire.h"
+
+TwoWire Wire;
+
+static double simTemperature = 22.5;
+static double simHumidity = 45.0;
+static uint8_t simHdcPointer = 0;
+static bool simHdcConverting = false;
+static unsigned long simHdcStarted = 0;
+
+void simSetClimate(double temperature, double humidity)
+{
+    simTemperature = temperature;
+    simHumidity = humidity;
+}
+
+void TwoWire::beginTransmission(uint8_t addr)
+{
+    address = addr;
+    txLength = 0;
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+    if(txLength >= sizeof txBuffer)
+    {
+        return 0;
+    }
+    txBuffer[txLength++] = data;
+    return 1;
+}
+
+// 0 on success, 2 for an address NACK like the AVR Wire library
+uint8_t TwoWire::endTransmission(bool stop)
+{
+    (void) stop;
+    delayMicroseconds(SIM_I2C_US_PER_BYTE * (txLength + 1));
+    if(address != SIM_HDC1080_ADDRESS)
+    {
+        return 2;
+    }
+    if(txLength > 0)
+    {
+        simHdcPointer = txBuffer[0];
+        if(simHdcPointer == 0x00 && txLength == 1)
+        {
+            simHdcConverting = true;
+            simHdcStarted = micros();
+        }
+    }
+    return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t addr, uint8_t quantity)
+{
+    rxLength = 0;
+    rxIndex = 0;
+    delayMicroseconds(SIM_I2C_US_PER_BYTE);
+    if(addr != SIM_HDC1080_ADDRESS || quantity > sizeof rxBuffer)
+    {
+        return 0;
+    }
+    if(simHdcPointer == 0x00)
+    {
+        if(!simHdcConverting || micros() - simHdcStarted < SIM_HDC1080_CONVERSION_US)
+        {
+            return 0; // still converting
+        }
+        simHdcConverting = false;
+        uint16_t rawTemp = (uint16_t) ((simTemperature + 40.0) * 65536.0 / 165.0 + 0.5);
+        uint16_t rawHum = (uint16_t) (simHumidity * 65536.0 / 100.0 + 0.5);
+        uint8_t data[4] = { (uint8_t) (rawTemp >> 8), (uint8_t) rawTemp, (uint8_t) (rawHum >> 8), (uint8_t) rawHum };
+        for(uint8_t i = 0; i < quantity; i++)
+        {
+            rxBuffer[i] = i < 4 ? data[i] : 0;
+        }
+    }
+    else
+    {
+        memset(rxBuffer, 0, quantity);
+    }
+    rxLength = quantity;
+    delayMicroseconds(SIM_I2C_US_PER_BYTE * quantity);
+    return quantity;
+}
+
+int TwoWire::available()
+{
+    return rxLength - rxIndex;
+}
+
+int TwoWire::read()
+{
+    return rxIndex < rxLength ? rxBuffer[rxIndex++] : -1;
+}
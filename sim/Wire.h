@@ -0,0 +1,43 @@
+#ifndef SIM_WIRE
+#define SIM_WIRE
+
+// Host stand-in for the Wire library with an HDC1080 on the bus at 0x40.
+// Writing register pointer 0x00 starts a conversion, and reading before
+// it is done gets a NACK (0 bytes), like the real part. Readings come
+// from SIM_TEMP and SIM_HUM. Each byte on the bus holds the CPU for
+// 100 us, which is 100 kHz I2C.
+
+#include <Arduino.h>
+
+#define SIM_HDC1080_ADDRESS 0x40
+#define SIM_HDC1080_CONVERSION_US 12850 // 14 bit temperature + 14 bit humidity
+#define SIM_I2C_US_PER_BYTE 100
+
+class TwoWire
+{
+  public:
+    void begin() {}
+    void setClock(uint32_t clock) { (void) clock; }
+    void beginTransmission(uint8_t address);
+    size_t write(uint8_t data);
+    uint8_t endTransmission(bool stop = true);
+    uint8_t requestFrom(uint8_t address, uint8_t quantity);
+    int available();
+    int read();
+
+  private:
+    uint8_t address;
+    uint8_t txBuffer[8];
+    uint8_t txLength;
+    uint8_t rxBuffer[8];
+    uint8_t rxLength;
+    uint8_t rxIndex;
+};
+
+extern TwoWire Wire;
+
+// sim side, sets what the sensor reads
+void simSetClimate(double temperature, double humidity);
+
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef SIM_AVR_IO
+#define SIM_AVR_IO
+
+// Just enough of the ATmega2560 register file for the firmware's timer
+// setup to run unmodified. Timers 3, 4 and 5 are emulated in CTC mode by
+// SimTimers.cpp, which calls the compare A vectors at the programmed rate.
+// cli() and the SREG save/restore do nothing because task code and the
+// emulated interrupts already exclude each other through the sim lock.
+
+#include <stdint.h>
+
+#define _BV(bit) (1 << (bit))
+
+extern volatile uint8_t SREG;
+inline void cli() {}
+inline void sei() {}
+
+#define ISR(vector) extern "C" void vector(void); extern "C" void vector(void)
+
+extern volatile uint8_t TCCR3A, TCCR3B, TIMSK3, TIFR3;
+extern volatile uint8_t TCCR4A, TCCR4B, TIMSK4, TIFR4;
+extern volatile uint8_t TCCR5A, TCCR5B, TIMSK5, TIFR5;
+extern volatile uint16_t TCNT3, OCR3A, TCNT4, OCR4A, TCNT5, OCR5A;
+
+#define CS30 0
+#define CS31 1
+#define CS32 2
+#define WGM32 3
+#define OCIE3A 1
+#define OCF3A 1
+#define CS40 0
+#define CS41 1
+#define CS42 2
+#define WGM42 3
+#define OCIE4A 1
+#define OCF4A 1
+#define CS50 0
+#define CS51 1
+#define CS52 2
+#define WGM52 3
+#define OCIE5A 1
+#define OCF5A 1
+
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef SIM_AVR_PGMSPACE
+#define SIM_AVR_PGMSPACE
+
+// flash and RAM are the same thing on the host
+#include <string.h>
+#include <stdint.h>
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define pgm_read_ptr(addr) (*(void * const *)(addr))
+#define memcpy_P memcpy
+
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef SIM_AVR_POWER
+#define SIM_AVR_POWER
+
+#define clock_div_1 0
+#define clock_prescale_set(div) ((void)(div))
+
+
+#endif
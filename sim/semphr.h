@@ -0,0 +1,13 @@
+#ifndef SIM_SEMPHR
+#define SIM_SEMPHR
+
+#include "queue.h"
+
+SemaphoreHandle_t xSemaphoreCreateBinary();
+SemaphoreHandle_t xSemaphoreCreateMutex();
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *woken);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t timeout);
+
+
+#endif
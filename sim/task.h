@@ -0,0 +1 @@
+#include "Arduino_FreeRTOS.h"
@@ -0,0 +1,325 @@
+#!/usr/bin/env python3
+"""Decodes the firmware's COBS framed binary telemetry.
+
+Reads a serial port (needs pyserial) or, with "-", stdin, e.g. the native
+sim's stdout:
+
+    telemetry_decode.py /dev/ttyACM0
+    SIM_SECONDS=5 .pio/build/native/program | telemetry_decode.py -
+
+Layouts match TelemetryStatus and TelemetryLog in Telemetry.h. --level
+sends a new log level to the board before reading, and each --send is a
+command line (see commandTable in main.cpp) sent once the previous one
+has been acknowledged, e.g. --send "mode 1" --send "step 512".
+
+The latency command sends the input to output latency histograms, one
+line per mode, with percentiles given as the top of the bucket they fall in.
+
+Firmware built with -DTRACE answers the trace command with a dump of its
+event ring. --trace FILE writes each dump as Chrome trace JSON, which
+chrome://tracing and ui.perfetto.dev open:
+
+    telemetry_decode.py /dev/ttyACM0 --send trace --trace trace.json
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+TELEMETRY_BAUD = 115200
+TELEMETRY_STATUS = 0x01
+TELEMETRY_LOG = 0x02
+TELEMETRY_TASK = 0x03
+TELEMETRY_TRACE_NAME = 0x04
+TELEMETRY_TRACE = 0x05
+TELEMETRY_LATENCY = 0x06
+TELEMETRY_FRAMES = 0x07
+LOG_EVT_COMMAND = 8
+
+STATUS = struct.Struct("<BBBBIHhhhhhhHB")
+TASK = struct.Struct("<BBB8sHHHH")
+LOG = struct.Struct("<BBBhI")
+TRACE_NAME = struct.Struct("<BBB8s")
+TRACE_HEAD = struct.Struct("<BBHH")
+TRACE_EVENT = struct.Struct("<HBB")
+FRAMES = struct.Struct("<BHHHHI")
+LATENCY_BUCKETS = 14
+LATENCY = struct.Struct("<BBHHI%dH" % LATENCY_BUCKETS)
+LEVELS = ["error", "info", "debug"]
+COMMAND_RESULTS = {0: "ok", -1: "unknown", -2: "bad arguments", -3: "too long", -4: "busy", -5: "out of range"}
+
+
+def centi(value):
+    sign = "-" if value < 0 else ""
+    value = abs(value)
+    return "%s%d.%02d" % (sign, value // 100, value % 100)
+
+
+LOG_EVENTS = {
+    1: lambda v: "T=%sC" % centi(v),
+    2: lambda v: "RH=%s%%" % centi(v),
+    3: lambda v: "Stop",
+    4: lambda v: "Stepper %d" % v,
+    5: lambda v: "Pixels %d" % v,
+    6: lambda v: "%s queue not receiving" % ("stepper" if v == 0 else "pixel"),
+    7: lambda v: "log level %s" % LEVELS[v] if 0 <= v < len(LEVELS) else v,
+    8: lambda v: "command %s" % COMMAND_RESULTS.get(v, v),
+    9: lambda v: "sensor %s failed" % ("trigger" if v == 0 else "read"),
+}
+
+
+# event types and interrupts from Trace.h
+TRACE_SWITCH_IN, TRACE_SWITCH_OUT = 1, 2
+TRACE_QUEUE_SEND, TRACE_QUEUE_RECEIVE, TRACE_QUEUE_BLOCK, TRACE_QUEUE_FAILED = 3, 4, 5, 6
+TRACE_NOTIFY, TRACE_ISR_ENTER, TRACE_ISR_EXIT, TRACE_TICK = 7, 8, 9, 10
+TRACE_NONE = 0xFF
+TRACE_ISRS = {0: "display ISR", 1: "stepper ISR", 2: "inputs ISR"}
+QUEUE_EVENTS = {TRACE_QUEUE_SEND: "send", TRACE_QUEUE_RECEIVE: "receive",
+                TRACE_QUEUE_BLOCK: "block on", TRACE_QUEUE_FAILED: "failed on"}
+
+# Chrome trace threads, a task's is its run stats slot + 1
+TID_OTHER = 0
+TID_ISR = 100
+TID_TICK = 200
+
+
+class TraceDump:
+    """Collects the frames of one trace dump and turns them into Chrome trace events."""
+
+    def __init__(self):
+        self.tasks = {}
+        self.queues = {}
+        self.events = []
+        self.total = None
+
+    def add_name(self, kind, index, name):
+        (self.tasks if kind == 0 else self.queues)[index] = name
+
+    def add_events(self, first, total, events):
+        self.total = total
+        self.events[first:first + len(events)] = events
+
+    def complete(self):
+        return self.total is not None and len(self.events) >= self.total
+
+    def task_name(self, slot):
+        return self.tasks.get(slot, "other") if slot != TRACE_NONE else "other"
+
+    def chrome(self):
+        """Returns the dump as a Chrome trace event list.
+
+        Stamps are the low 16 bits of a microsecond count, so they wrap
+        every 65 ms. The tick events come every 16 ms, so no gap between
+        two events is long enough to hide a wrap."""
+        out = []
+        open_slices = {}
+        running = TID_OTHER
+        now = 0
+        last = None
+        for stamp, kind, index in self.events:
+            if last is not None:
+                now += (stamp - last) & 0xFFFF
+            last = stamp
+            tid = index + 1 if index != TRACE_NONE else TID_OTHER
+            if kind == TRACE_SWITCH_IN:
+                running = tid
+                out.append({"ph": "B", "tid": tid, "ts": now, "name": self.task_name(index)})
+                open_slices[tid] = open_slices.get(tid, 0) + 1
+            elif kind == TRACE_SWITCH_OUT:
+                # the dump can start with a task already running
+                if open_slices.get(tid):
+                    out.append({"ph": "E", "tid": tid, "ts": now})
+                    open_slices[tid] -= 1
+            elif kind == TRACE_ISR_ENTER:
+                isr_tid = TID_ISR + index
+                out.append({"ph": "B", "tid": isr_tid, "ts": now, "name": TRACE_ISRS.get(index, "ISR %d" % index)})
+                open_slices[isr_tid] = open_slices.get(isr_tid, 0) + 1
+            elif kind == TRACE_ISR_EXIT:
+                isr_tid = TID_ISR + index
+                if open_slices.get(isr_tid):
+                    out.append({"ph": "E", "tid": isr_tid, "ts": now})
+                    open_slices[isr_tid] -= 1
+            elif kind in QUEUE_EVENTS:
+                queue = self.queues.get(index, "queue %d" % index) if index != TRACE_NONE else "unnamed queue"
+                out.append({"ph": "i", "s": "t", "tid": running, "ts": now,
+                            "name": "%s %s" % (QUEUE_EVENTS[kind], queue)})
+            elif kind == TRACE_NOTIFY:
+                out.append({"ph": "i", "s": "t", "tid": running, "ts": now,
+                            "name": "notify %s" % self.task_name(index)})
+            elif kind == TRACE_TICK:
+                out.append({"ph": "i", "s": "t", "tid": TID_TICK, "ts": now, "name": "tick"})
+        for tid, count in open_slices.items():
+            out += [{"ph": "E", "tid": tid, "ts": now}] * count
+
+        names = {TID_OTHER: "other", TID_TICK: "tick"}
+        names.update((slot + 1, name) for slot, name in self.tasks.items())
+        names.update((TID_ISR + isr, name) for isr, name in TRACE_ISRS.items())
+        for tid, name in names.items():
+            out.append({"ph": "M", "tid": tid, "name": "thread_name", "args": {"name": name}})
+            out.append({"ph": "M", "tid": tid, "name": "thread_sort_index", "args": {"sort_index": tid}})
+        for event in out:
+            event["pid"] = 1
+        return out
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data) + 1:
+            raise ValueError("bad COBS code")
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def micros(us):
+    return "%dus" % us if us < 1000 else "%.3gms" % (us / 1000.0) if us < 1000000 else "%.3gs" % (us / 1000000.0)
+
+
+def latency_line(mode, missed, ignored, top, buckets):
+    """Summarises a latency histogram, bucket 0 is under 256 us and each one after doubles the top."""
+    tops = [256 << i for i in range(LATENCY_BUCKETS - 1)] + [None]
+    count = sum(buckets)
+
+    def percentile(percent):
+        seen = 0
+        for bucket, top_us in zip(buckets, tops):
+            seen += bucket
+            if seen * 100 >= count * percent and seen:
+                return "<" + micros(top_us) if top_us else ">=" + micros(tops[-2])
+        return "-"
+
+    spread = " ".join("%s:%d" % ("<" + micros(t) if t else ">=" + micros(tops[-2]), n)
+                      for n, t in zip(buckets, tops) if n)
+    return "           LATENCY mode=%d n=%d missed=%d ignored=%d p50%s p90%s p99%s max=%s  %s" % (
+        mode, count, missed, ignored, percentile(50), percentile(90), percentile(99), micros(top), spread)
+
+
+def decode_frame(frame, trace=None):
+    """Returns a line of text for one frame, without the 0 delimiter.
+
+    Trace frames are added to trace, a TraceDump, if one is given."""
+    payload = cobs_decode(frame)
+    if len(payload) < 3:
+        raise ValueError("short frame")
+    body, crc = payload[:-2], struct.unpack("<H", payload[-2:])[0]
+    if crc16(body) != crc:
+        raise ValueError("bad CRC")
+    if body[0] == TELEMETRY_STATUS and len(body) == STATUS.size:
+        (_, mode, dips, level, stamp, seq, temp, hum, temp_ewma, hum_ewma,
+         temp_slope, hum_slope, pos, busy) = STATUS.unpack(body)
+        return ("%10.3f STATUS mode=%d dips=%s level=%s seq=%d T=%s (ewma %s, %s/min) "
+                "RH=%s (ewma %s, %s/min) pos=%d%s" % (
+                    stamp / 1000.0, mode, format(dips, "08b"), LEVELS[level] if level < len(LEVELS) else level,
+                    seq, centi(temp), centi(temp_ewma), centi(temp_slope), centi(hum), centi(hum_ewma),
+                    centi(hum_slope), pos, " busy" if busy else ""))
+    if body[0] == TELEMETRY_TASK and len(body) == TASK.size:
+        _, index, count, name, cpu, stack_free, idle, asleep = TASK.unpack(body)
+        line = "           TASK   %d/%d %-8s cpu=%5.1f%% stack_free=%d" % (
+            index + 1, count, name.rstrip(b"\0").decode("ascii", "replace"), cpu / 10.0, stack_free)
+        if index + 1 == count:
+            line += "\n           TASK   idle     cpu=%5.1f%% asleep=%.1f%%" % (idle / 10.0, asleep / 10.0)
+        return line
+    if body[0] == TELEMETRY_LOG and len(body) == LOG.size:
+        _, level, event, value, stamp = LOG.unpack(body)
+        text = LOG_EVENTS.get(event, lambda v: "event %d value %d" % (event, v))(value)
+        label = "ACK" if event == LOG_EVT_COMMAND else LEVELS[level].upper() if level < len(LEVELS) else level
+        return "%10.3f %-5s %s" % (stamp / 1000.0, label, text)
+    if body[0] == TELEMETRY_FRAMES and len(body) == FRAMES.size:
+        _, count, overruns, dropped, jitter_mean, jitter_max = FRAMES.unpack(body)
+        return "           FRAMES pixels frames=%d overruns=%d dropped=%d jitter mean=%s max=%s" % (
+            count, overruns, dropped, micros(jitter_mean), micros(jitter_max))
+    if body[0] == TELEMETRY_LATENCY and len(body) == LATENCY.size:
+        _, mode, missed, ignored, top, *buckets = LATENCY.unpack(body)
+        return latency_line(mode, missed, ignored, top, buckets)
+    if body[0] == TELEMETRY_TRACE_NAME and len(body) == TRACE_NAME.size:
+        _, kind, index, name = TRACE_NAME.unpack(body)
+        name = name.rstrip(b"\0").decode("ascii", "replace")
+        if trace is not None:
+            trace.add_name(kind, index, name)
+        return "           TRACE  %s %d is %s" % ("queue" if kind else "task", index, name)
+    if body[0] == TELEMETRY_TRACE and len(body) >= TRACE_HEAD.size:
+        _, count, first, total = TRACE_HEAD.unpack_from(body)
+        if len(body) != TRACE_HEAD.size + count * TRACE_EVENT.size:
+            raise ValueError("trace frame length %d for %d events" % (len(body), count))
+        if trace is not None:
+            trace.add_events(first, total, [TRACE_EVENT.unpack_from(body, TRACE_HEAD.size + i * TRACE_EVENT.size)
+                                            for i in range(count)])
+        return "           TRACE  events %d to %d of %d" % (first, first + count, total)
+    raise ValueError("unknown frame type 0x%02x length %d" % (body[0], len(body)))
+
+
+def frames(stream):
+    buf = bytearray()
+    while True:
+        chunk = stream.read(1 if hasattr(stream, "in_waiting") else 4096)
+        if not chunk:
+            return
+        for byte in chunk:
+            if byte == 0:
+                if buf:
+                    yield bytes(buf)
+                buf = bytearray()
+            else:
+                buf.append(byte)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("port", help="serial port, or - for stdin")
+    parser.add_argument("--baud", type=int, default=TELEMETRY_BAUD)
+    parser.add_argument("--level", choices=LEVELS, help="log level to set on the board")
+    parser.add_argument("--send", action="append", default=[], help="command line to send, repeatable")
+    parser.add_argument("--trace", metavar="FILE", help="write trace dumps to FILE as Chrome trace JSON")
+    args = parser.parse_args()
+    pending = list(args.send)
+
+    if args.port == "-":
+        stream = sys.stdin.buffer
+        pending = []
+    else:
+        import serial
+        stream = serial.Serial(args.port, args.baud)
+        if args.level:
+            stream.write(("log %d\n" % LEVELS.index(args.level)).encode())
+        elif pending:
+            stream.write((pending.pop(0) + "\n").encode())
+
+    bad = 0
+    trace = TraceDump()
+    for frame in frames(stream):
+        try:
+            text = decode_frame(frame, trace)
+            print(text, flush=True)
+            if trace.complete():
+                if args.trace:
+                    with open(args.trace, "w") as out:
+                        json.dump({"traceEvents": trace.chrome()}, out)
+                    print("# %d trace events written to %s" % (len(trace.events), args.trace), file=sys.stderr)
+                trace = TraceDump()
+            if pending and " ACK " in text:
+                stream.write((pending.pop(0) + "\n").encode())
+        except ValueError as error:
+            bad += 1
+            print("# dropped frame: %s" % error, file=sys.stderr)
+    if bad:
+        print("# %d bad frames" % bad, file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()